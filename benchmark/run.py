@@ -47,7 +47,16 @@ def medianTime(name):
     return times[len(times) / 2]
 
 
-lexerTime = medianTime('lexer')
-fibTime = medianTime('fib')
-print 'date          lexer     fib'
-print '{0}  {1:6}s {2:6}s'.format(date.today(), lexerTime, fibTime)
+BENCHMARKS = ['lexer', 'fib', 'arrays', 'strings', 'numbers', 'maps',
+              'objects']
+
+times = [medianTime(name) for name in BENCHMARKS]
+
+header = 'date        '
+row = '{0}  '.format(date.today())
+for name, time in zip(BENCHMARKS, times):
+    header += '{0:>7} '.format(name)
+    row += '{0:6}s '.format(time)
+
+print header.rstrip()
+print row.rstrip()
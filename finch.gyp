@@ -8,6 +8,7 @@
     'GCC_ENABLE_CPP_RTTI': 'NO', # -fno-rtti
     'GCC_TREAT_WARNINGS_AS_ERRORS': 'YES',    # -Werror
     'GCC_WARN_CHECK_SWITCH_STATEMENTS': 'YES', # -Wswitch
+    'CLANG_CXX_LANGUAGE_STANDARD': 'c++0x', # -std=c++11
     'WARNING_CFLAGS': [
       '-Wall',
       '-W',
@@ -32,6 +33,7 @@
   },
   'target_defaults': {
     'default_configuration': 'Debug',
+    'cflags_cc': [ '-std=c++11' ],
     'configurations': {
       'Debug': {
       },
@@ -49,29 +51,47 @@
       'src/Base/FinchString.cpp',
       'src/Base/FinchString.h',
       'src/Base/Macros.h',
+      'src/Base/NumberFormat.cpp',
+      'src/Base/NumberFormat.h',
+      'src/Base/NumberKernels.cpp',
+      'src/Base/NumberKernels.h',
       'src/Base/Queue.h',
       'src/Base/Ref.h',
       'src/Base/Stack.h',
       'src/Base/StringTable.cpp',
       'src/Base/StringTable.h',
+      'src/Compiler/AssignmentFinder.cpp',
+      'src/Compiler/AssignmentFinder.h',
       'src/Compiler/Block.cpp',
       'src/Compiler/Block.h',
       'src/Compiler/Compiler.cpp',
       'src/Compiler/Compiler.h',
+      'src/Compiler/ObjectTemplate.h',
       'src/finch.1',
       'src/IErrorReporter.h',
       'src/IInterpreterHost.h',
       'src/Interpreter/ArgReader.h',
+      'src/Interpreter/CycleCollector.cpp',
+      'src/Interpreter/CycleCollector.h',
       'src/Interpreter/Fiber.cpp',
       'src/Interpreter/Fiber.h',
       'src/Interpreter/FileLineReader.cpp',
       'src/Interpreter/FileLineReader.h',
+      'src/Interpreter/Heap.cpp',
+      'src/Interpreter/Heap.h',
+      'src/Interpreter/HeapDump.cpp',
+      'src/Interpreter/HeapDump.h',
+      'src/Interpreter/INativeLoop.h',
       'src/Interpreter/Objects/ArrayObject.h',
       'src/Interpreter/Objects/BlockObject.h',
       'src/Interpreter/Objects/BlockObject.cpp',
       'src/Interpreter/Objects/DynamicObject.cpp',
       'src/Interpreter/Objects/DynamicObject.h',
       'src/Interpreter/Objects/FiberObject.h',
+      'src/Interpreter/Objects/IReferenceVisitor.h',
+      'src/Interpreter/Objects/MapObject.cpp',
+      'src/Interpreter/Objects/MapObject.h',
+      'src/Interpreter/Objects/NumberArrayObject.h',
       'src/Interpreter/Objects/NumberObject.h',
       'src/Interpreter/Objects/Object.cpp',
       'src/Interpreter/Objects/Object.h',
@@ -80,10 +100,16 @@
       'src/Interpreter/Primitives/ArrayPrimitives.h',
       'src/Interpreter/Primitives/BlockPrimitives.cpp',
       'src/Interpreter/Primitives/BlockPrimitives.h',
+      'src/Interpreter/Primitives/EtherPrimitives.cpp',
+      'src/Interpreter/Primitives/EtherPrimitives.h',
       'src/Interpreter/Primitives/FiberPrimitives.cpp',
       'src/Interpreter/Primitives/FiberPrimitives.h',
       'src/Interpreter/Primitives/IoPrimitives.cpp',
       'src/Interpreter/Primitives/IoPrimitives.h',
+      'src/Interpreter/Primitives/MapPrimitives.cpp',
+      'src/Interpreter/Primitives/MapPrimitives.h',
+      'src/Interpreter/Primitives/NumberArrayPrimitives.cpp',
+      'src/Interpreter/Primitives/NumberArrayPrimitives.h',
       'src/Interpreter/Primitives/NumberPrimitives.cpp',
       'src/Interpreter/Primitives/NumberPrimitives.h',
       'src/Interpreter/Primitives/ObjectPrimitives.cpp',
@@ -92,6 +118,7 @@
       'src/Interpreter/Primitives/StringPrimitives.h',
       'src/Interpreter/Primitives.cpp',
       'src/Interpreter/Primitives.h',
+      'src/Interpreter/RegisterStack.h',
       'src/Interpreter/Upvalue.cpp',
       'src/Interpreter/Upvalue.h',
       'src/Interpreter.cpp',
@@ -150,12 +177,23 @@
       'sources': [
         'src/Test/ArrayTests.cpp',
         'src/Test/ArrayTests.h',
+        'src/Test/DictionaryTests.cpp',
+        'src/Test/DictionaryTests.h',
+        'src/Test/FixedLineReader.h',
+        'src/Test/HeapTests.cpp',
+        'src/Test/HeapTests.h',
         'src/Test/LexerTests.cpp',
         'src/Test/LexerTests.h',
+        'src/Test/NumberFormatTests.cpp',
+        'src/Test/NumberFormatTests.h',
+        'src/Test/NumberKernelsTests.cpp',
+        'src/Test/NumberKernelsTests.h',
         'src/Test/QueueTests.cpp',
         'src/Test/QueueTests.h',
         'src/Test/RefTests.cpp',
         'src/Test/RefTests.h',
+        'src/Test/RegisterStackTests.cpp',
+        'src/Test/RegisterStackTests.h',
         'src/Test/StackTests.cpp',
         'src/Test/StackTests.h',
         'src/Test/StringTests.cpp',
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <iostream>
+#include <utility>
 
 #include "Macros.h"
 
 namespace Finch
 {
     // A resizable dynamic array class. Array items must support copying and
-    // a default constructor.
+    // a default constructor. Items are moved instead of copied when the
+    // array grows or shifts them, so types with cheap moves (Value, String,
+    // Ref) don't pay for a refcount change per item.
     template <class T>
     class Array
     {
@@ -49,6 +52,17 @@ namespace Finch
             AddAll(array);
         }
         
+        // Takes the items from the given array, leaving it empty.
+        Array(Array<T> && array)
+        :   mCount(array.mCount),
+            mCapacity(array.mCapacity),
+            mItems(array.mItems)
+        {
+            array.mCount = 0;
+            array.mCapacity = 0;
+            array.mItems = NULL;
+        }
+        
         ~Array()
         {
             Clear();
@@ -83,6 +97,14 @@ namespace Finch
             mItems[mCount++] = value;
         }
         
+        // Moves the given item onto the end of the array.
+        void Add(T && value)
+        {
+            EnsureCapacity(mCount + 1);
+            
+            mItems[mCount++] = std::move(value);
+        }
+        
         // Adds all of the items from the given array to this one.
         void AddAll(const Array<T> & array)
         {
@@ -98,6 +120,7 @@ namespace Finch
         void Clear()
         {
             if (mItems != NULL) delete [] mItems;
+            mItems = NULL;
             mCount = 0;
             mCapacity = 0;
         }
@@ -113,7 +136,7 @@ namespace Finch
             // Shift items up.
             for (int i = index; i < mCount - 1; i++)
             {
-                mItems[i] = mItems[i + 1];
+                mItems[i] = std::move(mItems[i + 1]);
             }
             
             mItems[mCount - 1] = T(); // clear the copy of the last item
@@ -155,6 +178,23 @@ namespace Finch
             return *this;
         }
         
+        // Takes the items from the given array, leaving it empty.
+        Array & operator=(Array && other)
+        {
+            if (&other == this) return *this;
+            
+            Clear();
+            mCount = other.mCount;
+            mCapacity = other.mCapacity;
+            mItems = other.mItems;
+            
+            other.mCount = 0;
+            other.mCapacity = 0;
+            other.mItems = NULL;
+            
+            return *this;
+        }
+        
         // Gets the item at the given index. Indexes are zero-based from the
         // beginning of the array. Negative indexes are from the end of the
         // array and go forward, so that -1 is the last item in the array.
@@ -182,9 +222,7 @@ namespace Finch
         {
             for (int i = 0; i < mCount / 2; i++)
             {
-                T temp = mItems[i];
-                mItems[i] = mItems[mCount - i - 1];
-                mItems[mCount - i - 1] = temp;
+                std::swap(mItems[i], mItems[mCount - i - 1]);
             }
         }
         
@@ -212,10 +250,10 @@ namespace Finch
             // create the new array
             T* newItems = new T[capacity];
             
-            // copy the items over
+            // move the items over
             for (int i = 0; i < mCount; i++)
             {
-                newItems[i] = mItems[i];
+                newItems[i] = std::move(mItems[i]);
             }
             
             // delete the old one
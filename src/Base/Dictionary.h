@@ -1,66 +1,181 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 
 #include "Macros.h"
 
 namespace Finch
 {
-    // A dictionary mapping keys to values. Uses a dynamically-grown hashtable.
-    // Both TKey and TValue must have default constructors as well as support
-    // copying. TKey must also have a HashCode() method.
-    template <class TKey, class TValue>
+    // Describes how a Dictionary hashes and compares keys of type TKey. By
+    // default, keys are compared with == and hashed with their HashCode()
+    // method. Key types that need something else can specialize this, or
+    // pass their own traits class to Dictionary.
+    template <class TKey>
+    struct DictionaryTraits
+    {
+        static unsigned int Hash(const TKey & key) { return key.HashCode(); }
+        
+        static bool Equals(const TKey & a, const TKey & b)
+        {
+            return a == b;
+        }
+    };
+    
+    // String ids are their own hash code.
+    template <>
+    struct DictionaryTraits<StringId>
+    {
+        static unsigned int Hash(StringId key) { return key; }
+        static bool Equals(StringId a, StringId b) { return a == b; }
+    };
+    
+    // Pointers are hashed by address. The low bits are shifted out since
+    // they're usually zero.
+    template <class T>
+    struct DictionaryTraits<T *>
+    {
+        static unsigned int Hash(T * key)
+        {
+            return static_cast<unsigned int>(reinterpret_cast<size_t>(key) >> 4);
+        }
+    
+        static bool Equals(T * a, T * b) { return a == b; }
+    };
+    
+    // A dictionary mapping keys to values. Both TKey and TValue must have
+    // default constructors as well as support copying. TTraits describes how
+    // to hash and compare keys.
+    //
+    // Most dictionaries are small: an object's fields, or the methods on an
+    // object that isn't a prototype. Up to INLINE_CAPACITY items are stored
+    // in an array inside the Dictionary itself and found by scanning it, so
+    // small dictionaries don't allocate at all. Bigger ones move into a
+    // hashtable that uses open addressing with Robin Hood linear probing:
+    // an item being inserted takes the slot of any item that is closer to
+    // its own home slot, which keeps probe sequences short and lets a failed
+    // lookup stop early. Removing an item shifts the ones after it back, so
+    // there are no tombstones.
+    template <class TKey, class TValue,
+              class TTraits = DictionaryTraits<TKey> >
     class Dictionary
     {
+    private:
+        struct Pair;
+        
     public:
+        // Walks the keys and values in a Dictionary in no particular order.
+        // Changing the Dictionary invalidates the iterator.
+        class Iterator
+        {
+        public:
+            Iterator(const Dictionary & dictionary)
+            :   mPairs(dictionary.Pairs()),
+                mSize(dictionary.PairsSize()),
+                mIndex(-1)
+            {
+                Next();
+            }
+            
+            // Gets whether or not the iterator has moved past the last item.
+            bool IsDone() const { return mIndex >= mSize; }
+            
+            // Advances to the next item.
+            void Next()
+            {
+                do
+                {
+                    mIndex++;
+                }
+                while (!IsDone() && (mPairs[mIndex].hash == EMPTY));
+            }
+            
+            const TKey &   Key()   const { return mPairs[mIndex].key; }
+            const TValue & Value() const { return mPairs[mIndex].value; }
+            
+        private:
+            const Pair * mPairs;
+            int          mSize;
+            int          mIndex;
+        };
+        
         Dictionary()
         :   mTable(NULL),
             mCount(0),
-            mTableSize(0)
+            mMask(0)
         {}
         
         ~Dictionary()
         {
-            if (mTable != NULL)
-            {
-                delete [] mTable;
-            }
+            delete [] mTable;
         }
         
-        // Looks up the value associated with the given key. Returns a null
-        // reference if the key was not found.
-        bool Find(const TKey & key, TValue * value)
+        // Gets the number of items in the Dictionary.
+        int Count() const { return mCount; }
+        
+        // Gets the number of bytes allocated for the hashtable. Items that
+        // are stored inline don't count.
+        int AllocatedBytes() const
         {
-            int index = FindIndex(key);            
-            
-            if (index == -1) return false;
+            if (mTable == NULL) return 0;
+            return (mMask + 1) * static_cast<int>(sizeof(Pair));
+        }
+        
+        // Looks up the value associated with the given key. Returns false if
+        // the key was not found.
+        bool Find(const TKey & key, TValue * value) const
+        {
+            const Pair * pair = FindPair(key, HashKey(key));
+            if (pair == NULL) return false;
             
-            *value = mTable[index].value;
+            *value = pair->value;
             return true;
         }
         
-        // Inserts the given value at the given key.
+        // Gets whether or not the given key is in the Dictionary.
+        bool Contains(const TKey & key) const
+        {
+            return FindPair(key, HashKey(key)) != NULL;
+        }
+        
+        // Inserts the given value at the given key. If the key is already
+        // present, its value is replaced.
         void Insert(const TKey & key, const TValue & value)
         {
-            mCount++;
-            EnsureCapacity();
+            unsigned int hash = HashKey(key);
             
-            // figure out where to insert it in the table. use open addressing
-            // and basic linear probing
-            int index = static_cast<int>(key.HashCode() & 0x7fffffff) % mTableSize;
-
-            // note that we shouldn't have to worry about an infinite loop here
-            // the previous call will ensure there are open spaces in the table
-            //### bob: hack. using .Length() here assumes TKey is string
-            while ((mTable[index].key.Length() > 0) &&
-                   (mTable[index].key != key))
+            Pair * existing = const_cast<Pair *>(FindPair(key, hash));
+            if (existing != NULL)
             {
-                index = (index + 1) % mTableSize;
+                existing->value = value;
+                return;
             }
             
-            // insert it into the table
-            mTable[index].key   = key;
-            mTable[index].value = value;
+            if (mTable == NULL)
+            {
+                if (mCount < INLINE_CAPACITY)
+                {
+                    mInline[mCount].key   = key;
+                    mInline[mCount].value = value;
+                    mInline[mCount].hash  = hash;
+                    mCount++;
+                    return;
+                }
+                
+                // Out of room inline, so move to a hashtable.
+                Resize(MIN_CAPACITY);
+            }
+            else if ((mCount + 1) * 100 > (mMask + 1) * MAX_LOAD_PERCENT)
+            {
+                Resize((mMask + 1) * GROW_FACTOR);
+            }
+            
+            Pair pair;
+            pair.key   = key;
+            pair.value = value;
+            pair.hash  = hash;
+            InsertInTable(pair);
+            mCount++;
         }
         
         // Replaces the value at the given key. If the key is not already
@@ -68,14 +183,10 @@ namespace Finch
         // replaces the value at that key and returns true.
         bool Replace(const TKey & key, const TValue & value)
         {
-            int index = FindIndex(key);
-            
-            // not found
-            if (index == -1) return false;
-            
-            // replace the value
-            mTable[index].value = value;
+            Pair * pair = const_cast<Pair *>(FindPair(key, HashKey(key)));
+            if (pair == NULL) return false;
             
+            pair->value = value;
             return true;
         }
         
@@ -83,295 +194,257 @@ namespace Finch
         // found and removed.
         bool Remove(const TKey & key)
         {
-            int index = FindIndex(key);
-            
-            // not found
-            if (index == -1) return false;
-            
-            // remove the item
-            mTable[index].key   = TKey();
-            mTable[index].value = TValue();
+            Pair * pair = const_cast<Pair *>(FindPair(key, HashKey(key)));
+            if (pair == NULL) return false;
             
             mCount--;
-            return true;
-        }
-        
-        // Removes all items from the Dictionary.
-        void Clear()
-        {
-            mCount = 0;
-            mTableSize = 0;
-            delete [] mTable;
-        }
-        
-    private:
-        // Gets the index of the item with the given key in the table, or -1
-        // if not found.
-        int FindIndex(const TKey & key)
-        {
-            // can't find it in an empty table
-            if (mTableSize == 0) return -1;
             
-            int index = static_cast<int>(key.HashCode() & 0x7fffffff) % mTableSize;
+            if (mTable == NULL)
+            {
+                // Keep the inline items packed at the front by moving the
+                // last one into the hole.
+                *pair = mInline[mCount];
+                mInline[mCount] = Pair();
+                return true;
+            }
             
+            // An empty slot ends a probe sequence, so shift the following
+            // items back one until reaching one that's already in its home
+            // slot (or an empty one).
+            int hole = static_cast<int>(pair - mTable);
             while (true)
             {
-                // stop if we found it
-                if (mTable[index].key == key) return index;
-                
-                // if we found an empty slot, the item must not be in the table
-                //### bob: hack. using .Length() here assumes TKey is string
-                if (mTable[index].key.Length() == 0) return -1;
+                int next = (hole + 1) & mMask;
+                if ((mTable[next].hash == EMPTY) ||
+                    (ProbeDistance(next) == 0)) break;
                 
-                // try the next slot
-                index = (index + 1) % mTableSize;
+                mTable[hole] = mTable[next];
+                hole = next;
             }
+            
+            mTable[hole] = Pair();
+            return true;
         }
         
-        void EnsureCapacity()
+        // Makes room for the given number of items, so that adding them won't
+        // need to grow the table again.
+        void Reserve(int count)
         {
-            // only resize if we're too full
-            if (mCount <= mTableSize * MAX_LOAD_PERCENT / 100) return;
-
-            // figure out the new table size
-            int oldSize = mTableSize;
-            mTableSize = MIN_CAPACITY;
-            if (oldSize >= MIN_CAPACITY)
+            if (count <= INLINE_CAPACITY) return;
+            
+            int capacity = (mTable == NULL) ? MIN_CAPACITY : (mMask + 1);
+            while (count * 100 > capacity * MAX_LOAD_PERCENT)
             {
-                mTableSize = oldSize * GROW_FACTOR;
+                capacity *= GROW_FACTOR;
             }
             
-            // create the new hashtable
-            Pair * oldTable = mTable;
-            mTable = new Pair[mTableSize];
+            if ((mTable == NULL) || (capacity > mMask + 1)) Resize(capacity);
+        }
+        
+        // Replaces the contents of this Dictionary with a copy of the given
+        // one. The items keep the same slots, so nothing is rehashed.
+        void CopyFrom(const Dictionary & other)
+        {
+            if ((mCount > 0) || (mTable != NULL)) Clear();
             
-            // move the existing items over
-            if (oldTable != NULL)
+            // Inline items are packed at the front.
+            if (other.mTable == NULL)
             {
-                for (int i = 0; i < oldSize; i++)
+                for (int i = 0; i < other.mCount; i++)
                 {
-                    //### bob: hack. using .Length() here assumes TKey is string
-                    if (oldTable[i].key.Length() > 0)
-                    {
-                        Insert(oldTable[i].key, oldTable[i].value);
-                    }
+                    mInline[i] = other.mInline[i];
                 }
-                
-                delete [] oldTable;
             }
+            else
+            {
+                mTable = new Pair[other.mMask + 1];
+                for (int i = 0; i <= other.mMask; i++)
+                {
+                    mTable[i] = other.mTable[i];
+                }
+            }
+            
+            mCount = other.mCount;
+            mMask  = other.mMask;
         }
         
+        // Removes all items from the Dictionary.
+        void Clear()
+        {
+            delete [] mTable;
+            mTable = NULL;
+            mMask = 0;
+            
+            for (int i = 0; i < INLINE_CAPACITY; i++)
+            {
+                mInline[i] = Pair();
+            }
+            
+            mCount = 0;
+        }
+        
+    private:
+        // Hashes are stored with the top bit set so that zero can mark an
+        // empty slot. Only the low bits pick a slot, so this costs nothing.
+        static const unsigned int EMPTY    = 0;
+        static const unsigned int HASH_SET = 0x80000000;
+        
+        // How many items are stored inline before switching to a hashtable.
+        static const int INLINE_CAPACITY = 4;
+        
         // What percentage of the table should be filled with values before
         // it is resized.
         static const int MAX_LOAD_PERCENT = 75;
         
-        static const int MIN_CAPACITY = 16;
+        // Table sizes must be powers of two.
+        static const int MIN_CAPACITY = 8;
         static const int GROW_FACTOR  = 2;
-
+        
+        // The hash comes first so that it packs next to a small key.
         struct Pair
         {
-            TKey   key;
-            TValue value;
+            unsigned int hash;
+            TKey         key;
+            TValue       value;
+            
+            Pair() : hash(EMPTY), key(), value() {}
         };
         
-        Pair * mTable;
-        int    mCount;     // number of items stored in the table
-        int    mTableSize; // size of the table itself
+        static unsigned int HashKey(const TKey & key)
+        {
+            return TTraits::Hash(key) | HASH_SET;
+        }
         
-        NO_COPY(Dictionary);
-    };
-
-    // TODO(bob): Total hack. Copy and pasting Dictionary so that we can use
-    // int keys is lame!
-    // A dictionary mapping non-negative ints to values. Uses a
-    // dynamically-grown hashtable. TValue must have a default constructor as
-    // well as support copying.
-    template <class TValue>
-    class IdTable
-    {
-    public:
-        IdTable()
-        :   mTable(NULL),
-            mCount(0),
-            mTableSize(0)
-        {}
+        // The items the iterator walks. Empty slots are skipped.
+        const Pair * Pairs() const
+        {
+            return (mTable == NULL) ? mInline : mTable;
+        }
         
-        ~IdTable()
+        int PairsSize() const
         {
-            if (mTable != NULL)
-            {
-                delete [] mTable;
-            }
+            return (mTable == NULL) ? mCount : (mMask + 1);
         }
         
-        // Looks up the value associated with the given key. Returns a null
-        // reference if the key was not found.
-        bool Find(StringId key, TValue * value)
+        // Gets how far the item in the given slot is from its home slot.
+        int ProbeDistance(int index) const
         {
-            int index = FindIndex(key);            
-            
-            if (index == -1) return false;
-            
-            *value = mTable[index].value;
-            return true;
+            unsigned int home = mTable[index].hash;
+            return static_cast<int>((index - home) & mMask);
         }
         
-        // Does a reverse look-up to find a key with the given value. May be
-        // slow. If there are multiple keys with the same value, chooses one
-        // arbitrarily. Returns `-1` if not found.
-        StringId FindKeyForValue(const TValue & value)
+        // Gets the item with the given key, or NULL if not found.
+        const Pair * FindPair(const TKey & key, unsigned int hash) const
         {
-            for (int i = 0; i < mTableSize; i++)
+            if (mTable == NULL)
             {
-                if (mTable[i].value == value)
+                for (int i = 0; i < mCount; i++)
                 {
-                    return mTable[i].key;
+                    if ((mInline[i].hash == hash) &&
+                        TTraits::Equals(mInline[i].key, key)) return &mInline[i];
                 }
+                
+                return NULL;
             }
             
-            // Not found.
-            return NO_STRING;
-        }
-        
-        // Inserts the given value at the given key.
-        void Insert(StringId key, const TValue & value)
-        {
-            mCount++;
-            EnsureCapacity();
-            
-            // figure out where to insert it in the table. use open addressing
-            // and basic linear probing
-            int index = static_cast<int>(key & 0x7fffffff) % mTableSize;
-            
-            // note that we shouldn't have to worry about an infinite loop here
-            // the previous call will ensure there are open spaces in the table
-            while ((mTable[index].key != NO_STRING) &&
-                   (mTable[index].key != key))
+            int index = static_cast<int>(hash) & mMask;
+            for (int distance = 0; ; distance++)
             {
-                index = (index + 1) % mTableSize;
+                const Pair & pair = mTable[index];
+                
+                // If we found an empty slot, or an item that is closer to
+                // its home than we are to ours, then the key would have
+                // taken this slot when it was inserted, so it isn't here.
+                if (pair.hash == EMPTY) return NULL;
+                if (ProbeDistance(index) < distance) return NULL;
+                
+                if ((pair.hash == hash) && TTraits::Equals(pair.key, key))
+                {
+                    return &pair;
+                }
+                
+                index = (index + 1) & mMask;
             }
-            
-            // insert it into the table
-            mTable[index].key   = key;
-            mTable[index].value = value;
-        }
-        
-        // Replaces the value at the given key. If the key is not already
-        // present, does nothing and returns false. Otherwise, it
-        // replaces the value at that key and returns true.
-        bool Replace(StringId key, const TValue & value)
-        {
-            int index = FindIndex(key);
-            
-            // not found
-            if (index == -1) return false;
-            
-            // replace the value
-            mTable[index].value = value;
-            
-            return true;
-        }
-        
-        // Removes the value with the given key. Returns true if the key was
-        // found and removed.
-        bool Remove(StringId key)
-        {
-            int index = FindIndex(key);
-            
-            // not found
-            if (index == -1) return false;
-            
-            // remove the item
-            mTable[index].key   = NO_STRING;
-            mTable[index].value = TValue();
-            
-            mCount--;
-            return true;
         }
         
-        // Removes all items from the Dictionary.
-        void Clear()
+        // Adds an item to the hashtable. Assumes it isn't already there and
+        // there is room for it.
+        void InsertInTable(Pair pair)
         {
-            mCount = 0;
-            mTableSize = 0;
-            delete [] mTable;
-        }
-        
-    private:
-        // Gets the index of the item with the given key in the table, or -1
-        // if not found.
-        int FindIndex(StringId key)
-        {
-            // can't find it in an empty table
-            if (mTableSize == 0) return -1;
-            
-            int index = static_cast<int>(key & 0x7fffffff) % mTableSize;
-            
-            while (true)
+            int index = static_cast<int>(pair.hash) & mMask;
+            for (int distance = 0; ; distance++)
             {
-                // stop if we found it
-                if (mTable[index].key == key) return index;
+                if (mTable[index].hash == EMPTY)
+                {
+                    mTable[index] = pair;
+                    return;
+                }
                 
-                // if we found an empty slot, the item must not be in the table
-                if (mTable[index].key == NO_STRING) return -1;
+                // Take the slot from an item that's richer than us, and go
+                // on to find a new place for it instead.
+                int existing = ProbeDistance(index);
+                if (existing < distance)
+                {
+                    Pair displaced = mTable[index];
+                    mTable[index] = pair;
+                    pair = displaced;
+                    distance = existing;
+                }
                 
-                // try the next slot
-                index = (index + 1) % mTableSize;
+                index = (index + 1) & mMask;
             }
         }
         
-        void EnsureCapacity()
+        // Moves all of the items into a new hashtable of the given size.
+        void Resize(int capacity)
         {
-            // only resize if we're too full
-            if (mCount <= mTableSize * MAX_LOAD_PERCENT / 100) return;
-            
-            // figure out the new table size
-            int oldSize = mTableSize;
-            mTableSize = MIN_CAPACITY;
-            if (oldSize >= MIN_CAPACITY)
-            {
-                mTableSize = oldSize * GROW_FACTOR;
-            }
-            
-            // create the new hashtable
             Pair * oldTable = mTable;
-            mTable = new Pair[mTableSize];
+            int    oldSize  = PairsSize();
+            Pair * oldPairs = (oldTable == NULL) ? mInline : oldTable;
             
-            // move the existing items over
-            if (oldTable != NULL)
+            mTable = new Pair[capacity];
+            mMask  = capacity - 1;
+            
+            for (int i = 0; i < oldSize; i++)
             {
-                for (int i = 0; i < oldSize; i++)
-                {
-                    if (oldTable[i].key != NO_STRING)
-                    {
-                        Insert(oldTable[i].key, oldTable[i].value);
-                    }
-                }
+                if (oldPairs[i].hash == EMPTY) continue;
                 
-                delete [] oldTable;
+                InsertInTable(oldPairs[i]);
+                oldPairs[i] = Pair();
             }
+            
+            delete [] oldTable;
         }
         
-        // What percentage of the table should be filled with values before
-        // it is resized.
-        static const int MAX_LOAD_PERCENT = 75;
+        Pair   mInline[INLINE_CAPACITY];
+        Pair * mTable;  // NULL while the items fit inline
+        int    mCount;  // number of items stored
+        int    mMask;   // size of the table minus one
         
-        static const int MIN_CAPACITY = 16;
-        static const int GROW_FACTOR  = 2;
-        
-        struct Pair
+        NO_COPY(Dictionary);
+    };
+
+    // A dictionary mapping non-negative ints to values. TValue must have a
+    // default constructor as well as support copying.
+    template <class TValue>
+    class IdTable : public Dictionary<StringId, TValue>
+    {
+    public:
+        // Does a reverse look-up to find a key with the given value. May be
+        // slow. If there are multiple keys with the same value, chooses one
+        // arbitrarily. Returns `-1` if not found.
+        StringId FindKeyForValue(const TValue & value) const
         {
-            StringId    key;
-            TValue      value;
+            typedef typename Dictionary<StringId, TValue>::Iterator Iterator;
             
-            Pair() : key(NO_STRING) {}
-        };
-        
-        Pair * mTable;
-        int    mCount;     // number of items stored in the table
-        int    mTableSize; // size of the table itself
-        
-        NO_COPY(IdTable);
+            for (Iterator it(*this); !it.IsDone(); it.Next())
+            {
+                if (it.Value() == value) return it.Key();
+            }
+            
+            // Not found.
+            return NO_STRING;
+        }
     };
 }
 
@@ -1,19 +1,498 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <cstring>
+#include <new>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FINCH_SIMD_SEARCH
+#include <immintrin.h>
+#endif
+
+#include "Array.h"
 #include "Macros.h"
 #include "FinchString.h"
 
 namespace Finch
 {
+    // The two halves of an unflattened concatenation. Stored in the same
+    // block as the StringData that refers to them.
+    struct String::Halves
+    {
+        Halves(const String & left, const String & right)
+        :   left(left),
+            right(right)
+        {}
+        
+        String left;
+        String right;
+    };
+    
+    // The heap representation of a string too long to store inline. Each is
+    // allocated as a single block with whatever it refers to following it:
+    // the characters of a flat string, or the halves of a concatenation.
+    struct String::StringData
+    {
+        // Creates a flat string with room for `length` characters. They are
+        // terminated but otherwise left for the caller to fill in.
+        static StringData * Create(int length);
+        
+        // Creates a flat string holding a copy of the given characters.
+        static StringData * Create(const char * text, int length);
+        
+        // Creates an unflattened concatenation of two non-empty strings.
+        static StringData * Concat(const String & left, const String & right);
+        
+        // Creates a slice of `length` characters starting at `offset` in
+        // the given flat string that owns its buffer.
+        static StringData * Slice(StringData * source, int offset, int length);
+        
+        void Retain() { refCount++; }
+        
+        // Releases a reference and frees the data when it was the last one.
+        void Release();
+        
+        bool IsFlat() const { return chars != NULL; }
+        
+        // Copies the text of a concatenation into a single buffer and
+        // releases its halves.
+        void Flatten();
+        
+        // Copies the characters of a slice into a terminated buffer of its
+        // own. The slice keeps referring to the string it was taken from, so
+        // pointers to its characters stay valid.
+        void Terminate();
+        
+        int          refCount;
+        int          length;
+        const char * chars;    // NULL until a concatenation is flattened.
+                               // May not be terminated for a slice.
+        char *       buffer;   // A separately allocated buffer that chars
+                               // points to, if any. For a slice, a
+                               // terminated copy of its characters.
+        StringData * source;   // For a slice, the string whose buffer it
+                               // shares.
+        Halves *     halves;   // For a concatenation, its two halves. Empty
+                               // once flattened.
+        bool         isHashed;
+        unsigned int hashCode; // Not valid until isHashed is true.
+        
+    private:
+        static StringData * Allocate(int length, size_t extra);
+        
+        // Frees this data. Its halves must already have been released.
+        void Free();
+    };
+    
+    // Finds the first (or last) place `needle` occurs in `text` and returns
+    // its offset, or -1 if it isn't there. The needle must not be empty or
+    // longer than the text.
+    typedef int (*SearchFunction)(const char * text, int length,
+                                  const char * needle, int needleLength);
+    
+    // Checks the middle of a possible match whose first and last characters
+    // are already known to match.
+    static inline bool MatchesAt(const char * text, const char * needle,
+                                 int needleLength)
+    {
+        if (needleLength <= 2) return true;
+        return memcmp(text + 1, needle + 1, needleLength - 2) == 0;
+    }
+    
+    static int FindScalar(const char * text, int length,
+                          const char * needle, int needleLength)
+    {
+        const char   last = needle[needleLength - 1];
+        const char * end  = text + length - needleLength + 1;
+        
+        // memchr() is usually vectorized, so use it to skip to candidates.
+        const char * position = text;
+        while (position < end)
+        {
+            position = static_cast<const char *>(
+                memchr(position, needle[0], end - position));
+            if (position == NULL) return -1;
+            
+            if ((position[needleLength - 1] == last) &&
+                MatchesAt(position, needle, needleLength))
+            {
+                return static_cast<int>(position - text);
+            }
+            
+            position++;
+        }
+        
+        return -1;
+    }
+    
+    static int FindLastScalar(const char * text, int length,
+                              const char * needle, int needleLength)
+    {
+        const char last = needle[needleLength - 1];
+        
+        for (int i = length - needleLength; i >= 0; i--)
+        {
+            if ((text[i] == needle[0]) && (text[i + needleLength - 1] == last) &&
+                MatchesAt(text + i, needle, needleLength)) return i;
+        }
+        
+        return -1;
+    }
+    
+#ifdef FINCH_SIMD_SEARCH
+    // The vectorized searches test a block of starting positions at once by
+    // comparing the first and last characters of the needle against the
+    // text at each position. Only the positions where both match are checked
+    // with memcmp(). Positions left over at the end are handed to the scalar
+    // search.
+    
+    __attribute__((target("sse2")))
+    static int FindSse2(const char * text, int length,
+                        const char * needle, int needleLength)
+    {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last  = _mm_set1_epi8(needle[needleLength - 1]);
+        
+        int positions = length - needleLength + 1;
+        int i = 0;
+        for (; i + 16 <= positions; i += 16)
+        {
+            __m128i firstBlock = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(text + i));
+            __m128i lastBlock = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(text + i + needleLength - 1));
+            
+            unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(first, firstBlock),
+                _mm_cmpeq_epi8(last, lastBlock)));
+            
+            while (mask != 0)
+            {
+                int bit = __builtin_ctz(mask);
+                if (MatchesAt(text + i + bit, needle, needleLength)) return i + bit;
+                mask &= mask - 1;
+            }
+        }
+        
+        int found = FindScalar(text + i, length - i, needle, needleLength);
+        return (found == -1) ? -1 : i + found;
+    }
+    
+    __attribute__((target("sse2")))
+    static int FindLastSse2(const char * text, int length,
+                            const char * needle, int needleLength)
+    {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last  = _mm_set1_epi8(needle[needleLength - 1]);
+        
+        int positions = length - needleLength + 1;
+        int i = positions - 16;
+        for (; i >= 0; i -= 16)
+        {
+            __m128i firstBlock = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(text + i));
+            __m128i lastBlock = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(text + i + needleLength - 1));
+            
+            unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(first, firstBlock),
+                _mm_cmpeq_epi8(last, lastBlock)));
+            
+            while (mask != 0)
+            {
+                int bit = 31 - __builtin_clz(mask);
+                if (MatchesAt(text + i + bit, needle, needleLength)) return i + bit;
+                mask &= ~(1u << bit);
+            }
+        }
+        
+        // The positions before the last block are left.
+        return FindLastScalar(text, i + 16 + needleLength - 1,
+                              needle, needleLength);
+    }
+    
+    __attribute__((target("avx2")))
+    static inline uint64_t MatchMaskAvx2(const char * text, int needleLength,
+                                         __m256i first, __m256i last)
+    {
+        __m256i firstBlock = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(text));
+        __m256i lastBlock = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(text + needleLength - 1));
+        
+        return static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(first, firstBlock),
+            _mm256_cmpeq_epi8(last, lastBlock))));
+    }
+    
+    __attribute__((target("avx2")))
+    static int FindAvx2(const char * text, int length,
+                        const char * needle, int needleLength)
+    {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last  = _mm256_set1_epi8(needle[needleLength - 1]);
+        
+        // Test two blocks per iteration since most of them won't have any
+        // candidates at all.
+        int positions = length - needleLength + 1;
+        int i = 0;
+        for (; i + 64 <= positions; i += 64)
+        {
+            uint64_t mask = MatchMaskAvx2(text + i, needleLength, first, last) |
+                (MatchMaskAvx2(text + i + 32, needleLength, first, last) << 32);
+            
+            while (mask != 0)
+            {
+                int bit = __builtin_ctzll(mask);
+                if (MatchesAt(text + i + bit, needle, needleLength)) return i + bit;
+                mask &= mask - 1;
+            }
+        }
+        
+        int found = FindSse2(text + i, length - i, needle, needleLength);
+        return (found == -1) ? -1 : i + found;
+    }
+    
+    __attribute__((target("avx2")))
+    static int FindLastAvx2(const char * text, int length,
+                            const char * needle, int needleLength)
+    {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last  = _mm256_set1_epi8(needle[needleLength - 1]);
+        
+        int positions = length - needleLength + 1;
+        int i = positions - 32;
+        for (; i >= 0; i -= 32)
+        {
+            __m256i firstBlock = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(text + i));
+            __m256i lastBlock = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(text + i + needleLength - 1));
+            
+            unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_cmpeq_epi8(first, firstBlock),
+                _mm256_cmpeq_epi8(last, lastBlock)));
+            
+            while (mask != 0)
+            {
+                int bit = 31 - __builtin_clz(mask);
+                if (MatchesAt(text + i + bit, needle, needleLength)) return i + bit;
+                mask &= ~(1u << bit);
+            }
+        }
+        
+        return FindLastSse2(text, i + 32 + needleLength - 1,
+                            needle, needleLength);
+    }
+#endif
+    
+    // Picks the fastest forward search this CPU supports.
+    static SearchFunction ChooseFind()
+    {
+#ifdef FINCH_SIMD_SEARCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return FindAvx2;
+        if (__builtin_cpu_supports("sse2")) return FindSse2;
+#endif
+        return FindScalar;
+    }
+    
+    // Picks the fastest backward search this CPU supports.
+    static SearchFunction ChooseFindLast()
+    {
+#ifdef FINCH_SIMD_SEARCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return FindLastAvx2;
+        if (__builtin_cpu_supports("sse2")) return FindLastSse2;
+#endif
+        return FindLastScalar;
+    }
+    
+    static int Find(const char * text, int length,
+                    const char * needle, int needleLength)
+    {
+        // The C library's memchr() is already as fast as it gets for a single
+        // character.
+        if (needleLength == 1)
+        {
+            const void * found = memchr(text, needle[0], length);
+            if (found == NULL) return -1;
+            return static_cast<int>(static_cast<const char *>(found) - text);
+        }
+        
+        static const SearchFunction search = ChooseFind();
+        return search(text, length, needle, needleLength);
+    }
+    
+    static int FindLast(const char * text, int length,
+                        const char * needle, int needleLength)
+    {
+        static const SearchFunction search = ChooseFindLast();
+        return search(text, length, needle, needleLength);
+    }
+    
+    const int String::MaxInlineLength;
+    
     const char * String::sEmptyString = "";
     
-    String::StringData::StringData(const char * text)
-    :   chars(text)
+    String::StringData * String::StringData::Allocate(int length, size_t extra)
+    {
+        StringData * data = static_cast<StringData *>(
+            ::operator new(sizeof(StringData) + extra));
+        
+        data->refCount = 1;
+        data->length = length;
+        data->chars = NULL;
+        data->buffer = NULL;
+        data->source = NULL;
+        data->halves = NULL;
+        data->isHashed = false;
+        data->hashCode = 0;
+        
+        return data;
+    }
+    
+    String::StringData * String::StringData::Create(int length)
+    {
+        StringData * data = Allocate(length, length + 1);
+        
+        char * chars = reinterpret_cast<char *>(data + 1);
+        chars[length] = '\0';
+        data->chars = chars;
+        
+        return data;
+    }
+    
+    String::StringData * String::StringData::Create(const char * text,
+                                                    int length)
+    {
+        StringData * data = Create(length);
+        memcpy(const_cast<char *>(data->chars), text, length);
+        
+        return data;
+    }
+    
+    String::StringData * String::StringData::Concat(const String & left,
+                                                    const String & right)
+    {
+        ASSERT((left.Length() > 0) && (right.Length() > 0),
+               "Cannot concatenate an empty string.");
+        
+        StringData * data = Allocate(left.Length() + right.Length(),
+                                     sizeof(Halves));
+        data->halves = new (data + 1) Halves(left, right);
+        
+        return data;
+    }
+    
+    String::StringData * String::StringData::Slice(StringData * source,
+                                                   int offset, int length)
+    {
+        ASSERT(source->IsFlat() && (source->source == NULL),
+               "Can only slice a string that owns its buffer.");
+        
+        StringData * data = Allocate(length, 0);
+        data->chars = source->chars + offset;
+        data->source = source;
+        source->Retain();
+        
+        return data;
+    }
+    
+    void String::StringData::Release()
+    {
+        if (--refCount > 0) return;
+        
+        if (halves == NULL)
+        {
+            Free();
+            return;
+        }
+        
+        // Letting each node release its halves in turn would recurse once per
+        // node, and ropes built by appending in a loop are very deep. Instead,
+        // collect the nodes we held the last reference to and free them here.
+        Array<StringData *> dead;
+        dead.Add(this);
+        
+        while (!dead.IsEmpty())
+        {
+            StringData * node = dead[-1];
+            dead.RemoveAt(-1);
+            
+            if (node->halves != NULL)
+            {
+                StringData * left = node->halves->left.Steal();
+                StringData * right = node->halves->right.Steal();
+                
+                if ((left != NULL) && (--left->refCount == 0)) dead.Add(left);
+                if ((right != NULL) && (--right->refCount == 0)) dead.Add(right);
+            }
+            
+            node->Free();
+        }
+    }
+    
+    void String::StringData::Free()
     {
-        length = strlen(text);
-        hashCode = Fnv1Hash(text);
+        // The halves are empty by now, so destroying them does nothing more.
+        if (halves != NULL) halves->~Halves();
+        if (source != NULL) source->Release();
+        delete [] buffer;
+        
+        ::operator delete(this);
+    }
+    
+    void String::StringData::Flatten()
+    {
+        buffer = new char[length + 1];
+        
+        // Walk the leaves from left to right using an explicit stack. Ropes
+        // built by appending in a loop are very deep, so recursing here could
+        // overflow the native stack.
+        Array<const String *> pending;
+        pending.Add(&halves->right);
+        pending.Add(&halves->left);
+        
+        int position = 0;
+        while (!pending.IsEmpty())
+        {
+            const String * node = pending[-1];
+            pending.RemoveAt(-1);
+            
+            if (node->IsInline())
+            {
+                memcpy(buffer + position, node->mInline, node->Length());
+                position += node->Length();
+            }
+            else if (node->mData->IsFlat())
+            {
+                memcpy(buffer + position, node->mData->chars,
+                       node->mData->length);
+                position += node->mData->length;
+            }
+            else
+            {
+                // Push the right side first so the left is copied first.
+                pending.Add(&node->mData->halves->right);
+                pending.Add(&node->mData->halves->left);
+            }
+        }
+        
+        buffer[length] = '\0';
+        chars = buffer;
+        
+        StringData * left = halves->left.Steal();
+        StringData * right = halves->right.Steal();
+        if (left != NULL) left->Release();
+        if (right != NULL) right->Release();
+    }
+    
+    void String::StringData::Terminate()
+    {
+        buffer = new char[length + 1];
+        memcpy(buffer, chars, length);
+        buffer[length] = '\0';
     }
     
     String String::Format(const char* format, ...)
@@ -30,49 +509,108 @@ namespace Finch
         return String(result);
     }
     
+    String::String()
+    {
+        mInline[0] = '\0';
+        mInline[InlineSize - 1] = 0;
+    }
+    
     String::String(const char* chars)
     {
-        Init(chars, false);
+        Init(chars, static_cast<int>(strlen(chars)));
     }
     
     String::String(char c)
     {
-        char chars[2];
-        chars[0] = c;
-        chars[1] = '\0';
+        mInline[0] = c;
+        mInline[1] = '\0';
+        mInline[InlineSize - 1] = 1;
+    }
+    
+    String::String(const String & other)
+    {
+        memcpy(mInline, other.mInline, InlineSize);
+        if (!IsInline()) mData->Retain();
+    }
+    
+    String::String(String && other)
+    {
+        memcpy(mInline, other.mInline, InlineSize);
+        other.Steal();
+    }
+    
+    String::~String()
+    {
+        if (!IsInline()) mData->Release();
+    }
+    
+    String & String::operator =(const String & other)
+    {
+        // Retain first in case other is only kept alive by this string.
+        if (!other.IsInline()) other.mData->Retain();
+        if (!IsInline()) mData->Release();
         
-        Init(chars, false);
+        memcpy(mInline, other.mInline, InlineSize);
+        return *this;
+    }
+    
+    String & String::operator =(String && other)
+    {
+        if (&other == this) return *this;
+        
+        // Take the data before releasing ours in case other is only kept
+        // alive by this string.
+        StringData * old = IsInline() ? NULL : mData;
+        
+        memcpy(mInline, other.mInline, InlineSize);
+        other.Steal();
+        
+        if (old != NULL) old->Release();
+        return *this;
     }
     
     bool String::operator <(const String & other) const
     {
-        return strcmp(CString(), other.CString()) < 0;
+        return CompareTo(other) < 0;
     }
     
     bool String::operator <=(const String & other) const
     {
-        return strcmp(CString(), other.CString()) <= 0;
+        return CompareTo(other) <= 0;
     }
     
     bool String::operator >(const String & other) const
     {
-        return strcmp(CString(), other.CString()) > 0;
+        return CompareTo(other) > 0;
     }
     
     bool String::operator >=(const String & other) const
     {
-        return strcmp(CString(), other.CString()) >= 0;
+        return CompareTo(other) >= 0;
     }
     
     bool String::operator ==(const String & other) const
     {
         if (this == &other) return true;
+        if (Length() != other.Length()) return false;
+        
+        if (IsInline())
+        {
+            // Both are inline, since they're the same length.
+            return memcmp(mInline, other.mInline, Length()) == 0;
+        }
+        
         if (mData == other.mData) return true;
         
-        // if the hashes don't match, the strings must be different
-        if (HashCode() != other.HashCode()) return false;
+        const StringData & data = Flat();
+        const StringData & otherData = other.Flat();
         
-        return strcmp(CString(), other.CString()) == 0;
+        // if the hashes don't match, the strings must be different. don't
+        // calculate them just for this, though: that's as slow as comparing.
+        if (data.isHashed && otherData.isHashed &&
+            (data.hashCode != otherData.hashCode)) return false;
+        
+        return memcmp(data.chars, otherData.chars, Length()) == 0;
     }
     
     bool String::operator !=(const String & other) const
@@ -84,12 +622,18 @@ namespace Finch
     {
         ASSERT_RANGE(index, Length() + 1); // allow accessing the terminator
 
-        if (mData.IsNull()) return sEmptyString[0];
-        return mData->chars[index];
+        // A slice's characters may not be terminated.
+        if (index == Length()) return sEmptyString[0];
+        
+        return Chars()[index];
     }
     
     String String::operator +(const String & other) const
     {
+        // Don't bother creating a new string if one side is empty.
+        if (other.Length() == 0) return *this;
+        if (Length() == 0) return other;
+        
         return String(*this, other);
     }
     
@@ -112,65 +656,109 @@ namespace Finch
     
     const char* String::CString() const
     {
-        if (mData.IsNull()) return sEmptyString;
+        if (IsInline()) return mInline;
+        
+        StringData & data = Flat();
+        if (data.chars[data.length] == '\0') return data.chars;
         
-        return mData->chars;
+        // A slice that stops short of the end of the string it was taken from
+        // needs its own copy to be terminated. It's made once and kept as long
+        // as the slice is.
+        if (data.buffer == NULL) data.Terminate();
+        return data.buffer;
     }
 
     int String::Length() const
     {
-        if (mData.IsNull()) return 0;
+        if (IsInline()) return Tag();
         
         return mData->length;
     }
     
     int String::IndexOf(const String & other, int startIndex) const
     {
-        if (mData.IsNull()) return -1;
+        if (startIndex < 0) startIndex = 0;
         
-        // Keep the start index in bounds.
-        if (startIndex >= Length()) startIndex = Length() - 1;
+        // This also covers starting past the end.
+        int remaining = Length() - startIndex;
+        if (other.Length() > remaining) return -1;
+        if (other.Length() == 0) return startIndex;
         
-        const char* found = strstr(mData->chars + startIndex, other.CString());
-        if (found == NULL) return -1;
+        int found = Find(Chars() + startIndex, remaining,
+                         other.Chars(), other.Length());
+        return (found == -1) ? -1 : startIndex + found;
+    }
+    
+    int String::LastIndexOf(const String & other) const
+    {
+        if (other.Length() > Length()) return -1;
+        if (other.Length() == 0) return Length();
         
-        return static_cast<int>(found - mData->chars);
+        return FindLast(Chars(), Length(), other.Chars(), other.Length());
     }
 
     String String::Replace(const String & from, const String & to) const
     {
-        // TODO(bob): Could certainly be optimized.
+        if (from.Length() == 0) return *this;
+        
+        // Find all of the matches first so the result can be built in place.
+        Array<int> matches;
+        int index = IndexOf(from);
+        while (index != -1)
+        {
+            matches.Add(index);
+            index = IndexOf(from, index + from.Length());
+        }
+        
+        if (matches.Count() == 0) return *this;
+        
+        const char * text = Chars();
         String result;
+        char * chars = result.InitBuffer(Length() +
+            matches.Count() * (to.Length() - from.Length()));
         
         int start = 0;
-        while (start < Length())
+        for (int i = 0; i < matches.Count(); i++)
         {
-            int index = IndexOf(from, start);
-            if (index != -1)
-            {
-                result += Substring(start, index - start) + to;
-                start = index + from.Length();
-            }
-            else
-            {
-                result += Substring(start, Length() - start);
-                break;
-            }
+            memcpy(chars, text + start, matches[i] - start);
+            chars += matches[i] - start;
+            
+            memcpy(chars, to.Chars(), to.Length());
+            chars += to.Length();
+            
+            start = matches[i] + from.Length();
         }
         
+        memcpy(chars, text + start, Length() - start);
+        
         return result;
     }
 
     unsigned int String::HashCode() const
     {
-        if (mData.IsNull()) return EmptyStringHash;
+        // Short strings have nowhere to cache their hash, but hashing them is
+        // only a few steps anyway.
+        if (IsInline()) return Hash(mInline, Length());
 
-        return mData->hashCode;
+        StringData & data = Flat();
+        if (!data.isHashed)
+        {
+            data.hashCode = Hash(data.chars, data.length);
+            data.isHashed = true;
+        }
+        
+        return data.hashCode;
     }
 
     int String::CompareTo(const String & other) const
     {
-        return strcmp(CString(), other.CString());
+        int length = (Length() < other.Length()) ? Length() : other.Length();
+        
+        int result = memcmp(Chars(), other.Chars(), length);
+        if (result != 0) return result;
+        
+        // If one is a prefix of the other, the shorter one comes first.
+        return Length() - other.Length();
     }
 
     String String::Substring(int startIndex) const
@@ -183,11 +771,7 @@ namespace Finch
         
         ASSERT_RANGE(startIndex, Length());
         
-        int length = Length() - startIndex;
-        char* heap = new char[length + 1];
-        strcpy(heap, CString() + startIndex);
-        
-        return String(heap, true);
+        return Substring(startIndex, Length() - startIndex);
     }
     
     String String::Substring(int startIndex, int count) const
@@ -203,104 +787,179 @@ namespace Finch
             count = Length() + count - startIndex;
         }
         
+        if (count == 0) return String();
+        
         ASSERT_RANGE(startIndex, Length());
         ASSERT(startIndex + count <= Length(), "Range must not go past end of string.");
         
-        char* heap = new char[count + 1];
-        strncpy(heap, CString() + startIndex, count);
-        heap[count] = '\0';
+        if (count == Length()) return *this;
         
-        return String(heap, true);
+        // Short substrings are cheaper to copy than to share.
+        if (count <= MaxInlineLength) return String(Chars() + startIndex, count);
+        
+        return String(*this, startIndex, count);
     }
 
     String::String(const String & left, const String & right)
     {
-        // make a new buffer on the heap
         int length = left.Length() + right.Length();
-        char* heap = new char[length + 1];
         
-        // concatenate the strings
-        strcpy(heap, left.CString());
-        strcpy(&heap[left.Length()], right.CString());
+        // Long strings are joined lazily.
+        if (length >= MinRopeLength)
+        {
+            SetData(StringData::Concat(left, right));
+            return;
+        }
         
-        Init(heap, true);
+        char * chars = InitBuffer(length);
+        memcpy(chars, left.Chars(), left.Length());
+        memcpy(chars + left.Length(), right.Chars(), right.Length());
     }
     
-    String::String(const char * text, bool isOnHeap)
+    String::String(const String & source, int startIndex, int count)
     {
-        Init(text, isOnHeap);
-    }
+        StringData & data = source.Flat();
         
-    void String::Init(const char * text, bool isOnHeap)
-    {
-        if (isOnHeap)
+        if (data.source == NULL)
         {
-            mData = Ref<StringData>(new StringData(text));
+            SetData(StringData::Slice(&data, startIndex, count));
         }
         else
         {
-            // hoist it onto the heap
-            int length = strlen(text);
-            char * heap = new char[length + 1];
-            strcpy(heap, text);
-            
-            mData = Ref<StringData>(new StringData(heap));
+            // Slicing a slice, so refer directly to the original buffer.
+            int offset = static_cast<int>(data.chars - data.source->chars);
+            SetData(StringData::Slice(data.source, offset + startIndex, count));
         }
     }
-
-    unsigned int String::Fnv1Hash(const char * text)
+    
+    String::String(const char * text, int length)
+    {
+        Init(text, length);
+    }
+    
+    void String::Init(const char * text, int length)
+    {
+        memcpy(InitBuffer(length), text, length);
+    }
+    
+    char * String::InitBuffer(int length)
+    {
+        if (length <= MaxInlineLength)
+        {
+            mInline[length] = '\0';
+            mInline[InlineSize - 1] = static_cast<char>(length);
+            return mInline;
+        }
+        
+        SetData(StringData::Create(length));
+        return const_cast<char *>(mData->chars);
+    }
+    
+    void String::SetData(StringData * data)
+    {
+        mData = data;
+        mInline[InlineSize - 1] = static_cast<char>(HeapTag);
+    }
+    
+    String::StringData * String::Steal()
     {
-        // magical number!
-        const unsigned int fnvPrime = 0x01000193;
+        if (IsInline()) return NULL;
         
-        // treat as unsigned
-        const unsigned char * byte = reinterpret_cast<const unsigned char *>(text);
+        StringData * data = mData;
+        mInline[0] = '\0';
+        mInline[InlineSize - 1] = 0;
+        return data;
+    }
+    
+    String::StringData & String::Flat() const
+    {
+        if (!mData->IsFlat()) mData->Flatten();
+        return *mData;
+    }
+    
+    const char * String::Chars() const
+    {
+        if (IsInline()) return mInline;
+        
+        return Flat().chars;
+    }
+    
+    unsigned int String::Hash(const char * text, int length)
+    {
+        // This is MurmurHash64A. Unlike a byte-at-a-time hash like FNV, it
+        // mixes in eight bytes per step.
+        const uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
         
-        unsigned int hash = EmptyStringHash;
+        uint64_t hash = 0x8445d61a4e774912ULL ^ (length * m);
         
-        while (*byte != '\0')
+        const char * end = text + (length & ~7);
+        while (text != end)
         {
-            // multiply by the 32 bit FNV magic prime mod 2^32
-            hash *= fnvPrime;
-
-            // xor the bottom with the current octet
-            hash ^= static_cast<unsigned int>(*byte);
-            byte++;
+            // Use memcpy to read the word since it may not be aligned.
+            uint64_t word;
+            memcpy(&word, text, sizeof(word));
+            text += sizeof(word);
+            
+            word *= m;
+            word ^= word >> r;
+            word *= m;
+            
+            hash ^= word;
+            hash *= m;
+        }
+        
+        // Mix in the trailing bytes.
+        const unsigned char * tail = reinterpret_cast<const unsigned char *>(text);
+        int remaining = length & 7;
+        if (remaining > 0)
+        {
+            uint64_t word = 0;
+            for (int i = remaining - 1; i >= 0; i--)
+            {
+                word = (word << 8) | tail[i];
+            }
+            
+            hash ^= word;
+            hash *= m;
         }
         
-        return hash;
+        hash ^= hash >> r;
+        hash *= m;
+        hash ^= hash >> r;
+        
+        // Fold the high bits in so that none of them are lost.
+        return static_cast<unsigned int>(hash ^ (hash >> 32));
+    }
+    
+    bool String::Equals(const char * text) const
+    {
+        // Compare lengths first. This string may have null characters in it,
+        // so comparing with strncmp() could stop early and then look past the
+        // end of text.
+        if (strlen(text) != static_cast<size_t>(Length())) return false;
+        
+        return memcmp(Chars(), text, Length()) == 0;
     }
 
     bool operator ==(const char * left, const String & right)
     {
-        // if the hashes don't match, the strings must be different
-        if (String::Fnv1Hash(left) != right.HashCode()) return false;
-        
-        return strcmp(left, right.CString()) == 0;
+        return right.Equals(left);
     }
     
     bool operator !=(const char * left, const String & right)
     {
-        // if the hashes don't match, the strings must be different
-        if (String::Fnv1Hash(left) != right.HashCode()) return true;
-        
-        return strcmp(left, right.CString()) != 0;
+        return !right.Equals(left);
     }
     
     bool operator ==(const String & left, const char * right)
     {
-        // if the hashes don't match, the strings must be different
-        if (left.HashCode() != String::Fnv1Hash(right)) return false;
-        
-        return strcmp(left.CString(), right) == 0;
+        return left.Equals(right);
     }
     
     bool operator !=(const String & left, const char * right)
     {
-        // if the hashes don't match, the strings must be different
-        if (left.HashCode() != String::Fnv1Hash(right)) return true;
-        
-        return strcmp(left.CString(), right) != 0;
+        return !left.Equals(right);
     }
     
     ostream & operator <<(ostream & cout, const String & string)
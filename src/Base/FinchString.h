@@ -2,13 +2,18 @@
 
 #include <iostream>
 
-#include "Ref.h"
-
 namespace Finch
 {
     using std::ostream;
     
-    // Reference-counted heap-allocated immutable string class.
+    // Immutable string class. Strings of up to MaxInlineLength characters are
+    // stored directly inside the String object and never touch the heap.
+    // Longer strings share a reference-counted block that holds both the
+    // bookkeeping and the characters. Concatenating long strings doesn't copy
+    // them. Instead, it creates a rope node that refers to both halves and is
+    // only flattened into a single buffer when its characters or hash code are
+    // actually needed. Likewise, long substrings are slices that share the
+    // buffer of the string they were taken from.
     class String
     {
     public:
@@ -16,15 +21,22 @@ namespace Finch
         // number of arguments to be formatted.
         static String Format(const char* format, ...);
         
-        String() {}
+        String();
         
         String(const char* chars);
 
         explicit String(char c);
 
-        String(const String & other)
-        :   mData(other.mData)
-        {}
+        String(const String & other);
+        
+        // Moves a string. Takes over the other string's heap data, if any,
+        // and leaves it empty.
+        String(String && other);
+        
+        ~String();
+        
+        String & operator =(const String & other);
+        String & operator =(String && other);
         
         // Comparison operators.
         bool         operator < (const String & other) const;
@@ -44,20 +56,26 @@ namespace Finch
         String &     operator +=(char other);
         
         // Gets the raw character array for the string. Returns a reference to
-        // a zero-length string, not NULL, if the string is empty.
+        // a zero-length string, not NULL, if the string is empty. The result
+        // stays valid as long as the string does.
         const char * CString() const;
         
         // Gets the number of characters in the string.
         int Length() const;
         
-        // Gets the position in this string of the given substring or -1 if not
-        // found.
+        // Gets the position in this string of the first occurrence of the
+        // given substring at or after startIndex, or -1 if not found.
         int IndexOf(const String & other, int startIndex = 0) const;
         
+        // Gets the position in this string of the last occurrence of the given
+        // substring or -1 if not found.
+        int LastIndexOf(const String & other) const;
+        
         // Replaces every instance of `from` in the string with `to`.
         String Replace(const String & from, const String & to) const;
         
-        // Gets the hash code for the string.
+        // Gets the hash code for the string. For a long string, it is
+        // calculated the first time this is called and cached after that.
         unsigned int HashCode() const;
         
         int CompareTo(const String & other) const;
@@ -65,32 +83,79 @@ namespace Finch
         String Substring(int startIndex) const;
         String Substring(int startIndex, int count) const;
         
-        static unsigned int Fnv1Hash(const char * text);
+        // Hashes the given characters. Reads a word at a time, using the
+        // MurmurHash64A mixing function.
+        static unsigned int Hash(const char * text, int length);
+        
+        // The longest string that is stored inline.
+        static const int MaxInlineLength = 22;
         
     private:
-        struct StringData
-        {
-            StringData(const char * text);
-            
-            int          length;
-            const char * chars;
-            int          hashCode;
-        };
+        // The heap representation of a long string. Defined in the .cpp file.
+        struct StringData;
+        struct Halves;
         
         String(const String & left, const String & right);
-        String(const char * text, bool isOnHeap);
+        String(const String & source, int startIndex, int count);
+        String(const char * text, int length);
+        
+        void Init(const char * text, int length);
+        
+        // Sets up this string, which must not refer to heap data, to hold
+        // `length` characters. Returns the terminated but otherwise
+        // uninitialized buffer to write them to.
+        char * InitBuffer(int length);
         
-        void Init(const char * text, bool isOnHeap);
+        // Points this string at the given heap data, which it now owns a
+        // reference to.
+        void SetData(StringData * data);
+        
+        // Gives up this string's reference to its heap data, if any, without
+        // releasing it, and leaves the string empty.
+        StringData * Steal();
+        
+        bool IsInline() const { return Tag() != HeapTag; }
+        unsigned char Tag() const
+        {
+            return static_cast<unsigned char>(mInline[InlineSize - 1]);
+        }
+        
+        // Gets the flattened data for a string stored on the heap.
+        StringData & Flat() const;
+        
+        // Gets the characters of this string. Unlike CString(), these are
+        // not guaranteed to be terminated.
+        const char * Chars() const;
+        
+        // Compares this string to the given terminated C string.
+        bool Equals(const char * text) const;
         
         static const int FormattedStringMax = 512;
         
-        // The hash code of a zero-character string. This constant comes from
-        // the FNV1 hash algorithm used to hash strings.
-        static const unsigned int EmptyStringHash = 0x811c9dc5;
+        // Concatenations shorter than this are copied immediately instead of
+        // creating a rope node. Copying small strings is cheaper than the
+        // extra allocation and later flattening.
+        static const int MinRopeLength = 64;
+        
+        // Size of the inline buffer. Its last byte is the tag: the length of
+        // an inline string, or HeapTag if mData is used instead. An inline
+        // string of MaxInlineLength characters still leaves room for its
+        // terminator before the tag.
+        static const int InlineSize = MaxInlineLength + 2;
+        static const unsigned char HeapTag = 0xff;
         
         static const char * sEmptyString;
         
-        Ref<StringData> mData;
+        union
+        {
+            char         mInline[InlineSize];
+            StringData * mData;
+        };
+        
+        friend bool operator ==(const char * left, const String & right);
+        friend bool operator !=(const char * left, const String & right);
+        friend bool operator ==(const String & left, const char * right);
+        friend bool operator !=(const String & left, const char * right);
     };
     
     bool operator ==(const char * left, const String & right);
@@ -0,0 +1,492 @@
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#include "NumberFormat.h"
+
+namespace Finch
+{
+    // A floating point number with a 64-bit significand that Grisu does its
+    // arithmetic on: f * 2^e.
+    struct DiyFp
+    {
+        DiyFp()
+        :   f(0),
+            e(0)
+        {}
+        
+        DiyFp(uint64_t f, int e)
+        :   f(f),
+            e(e)
+        {}
+        
+        // Unpacks a positive double.
+        explicit DiyFp(double value)
+        {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            
+            int      biasedExponent = static_cast<int>((bits & ExponentMask) >> 52);
+            uint64_t significand    = bits & SignificandMask;
+            
+            if (biasedExponent != 0)
+            {
+                f = significand + HiddenBit;
+                e = biasedExponent - ExponentBias;
+            }
+            else
+            {
+                // Denormal.
+                f = significand;
+                e = 1 - ExponentBias;
+            }
+        }
+        
+        DiyFp operator -(const DiyFp & other) const
+        {
+            return DiyFp(f - other.f, e);
+        }
+        
+        // Multiplies the significands, keeping the rounded upper 64 bits of
+        // the product.
+        DiyFp operator *(const DiyFp & other) const
+        {
+            const uint64_t mask = 0xffffffff;
+            uint64_t a = f >> 32;
+            uint64_t b = f & mask;
+            uint64_t c = other.f >> 32;
+            uint64_t d = other.f & mask;
+            
+            uint64_t ac = a * c;
+            uint64_t bc = b * c;
+            uint64_t ad = a * d;
+            uint64_t bd = b * d;
+            
+            uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask);
+            middle += 1U << 31; // round
+            
+            return DiyFp(ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+                         e + other.e + 64);
+        }
+        
+        // Shifts the significand all the way to the top of the 64 bits.
+        DiyFp Normalize() const
+        {
+            DiyFp result = *this;
+            while ((result.f & HiddenBit) == 0)
+            {
+                result.f <<= 1;
+                result.e--;
+            }
+            
+            result.f <<= 11;
+            result.e -= 11;
+            return result;
+        }
+        
+        // Gets the boundaries halfway between this double and its neighbors.
+        // Any number strictly between them reads back as this double. Both
+        // are normalized to the same exponent.
+        void NormalizedBoundaries(DiyFp * minus, DiyFp * plus) const
+        {
+            DiyFp upper((f << 1) + 1, e - 1);
+            while ((upper.f & (HiddenBit << 1)) == 0)
+            {
+                upper.f <<= 1;
+                upper.e--;
+            }
+            
+            upper.f <<= 10;
+            upper.e -= 10;
+            
+            // At a power of two, the gap to the next smaller double is half
+            // as wide.
+            DiyFp lower = (f == HiddenBit) ? DiyFp((f << 2) - 1, e - 2)
+                                           : DiyFp((f << 1) - 1, e - 1);
+            lower.f <<= lower.e - upper.e;
+            lower.e = upper.e;
+            
+            *plus = upper;
+            *minus = lower;
+        }
+        
+        static const uint64_t ExponentMask    = 0x7ff0000000000000ULL;
+        static const uint64_t SignificandMask = 0x000fffffffffffffULL;
+        static const uint64_t HiddenBit       = 0x0010000000000000ULL;
+        static const int      ExponentBias    = 0x3ff + 52;
+        
+        uint64_t f;
+        int      e;
+    };
+    
+    struct CachedPower
+    {
+        uint64_t f;
+        int      e;
+    };
+    
+    // Normalized approximations of 10^k for k from -348 to 340 in steps of 8.
+    static const CachedPower sCachedPowers[] =
+    {
+        { 0xfa8fd5a0081c0288ULL, -1220 }, // 1e-348
+        { 0xbaaee17fa23ebf76ULL, -1193 }, // 1e-340
+        { 0x8b16fb203055ac76ULL, -1166 }, // 1e-332
+        { 0xcf42894a5dce35eaULL, -1140 }, // 1e-324
+        { 0x9a6bb0aa55653b2dULL, -1113 }, // 1e-316
+        { 0xe61acf033d1a45dfULL, -1087 }, // 1e-308
+        { 0xab70fe17c79ac6caULL, -1060 }, // 1e-300
+        { 0xff77b1fcbebcdc4fULL, -1034 }, // 1e-292
+        { 0xbe5691ef416bd60cULL, -1007 }, // 1e-284
+        { 0x8dd01fad907ffc3cULL,  -980 }, // 1e-276
+        { 0xd3515c2831559a83ULL,  -954 }, // 1e-268
+        { 0x9d71ac8fada6c9b5ULL,  -927 }, // 1e-260
+        { 0xea9c227723ee8bcbULL,  -901 }, // 1e-252
+        { 0xaecc49914078536dULL,  -874 }, // 1e-244
+        { 0x823c12795db6ce57ULL,  -847 }, // 1e-236
+        { 0xc21094364dfb5637ULL,  -821 }, // 1e-228
+        { 0x9096ea6f3848984fULL,  -794 }, // 1e-220
+        { 0xd77485cb25823ac7ULL,  -768 }, // 1e-212
+        { 0xa086cfcd97bf97f4ULL,  -741 }, // 1e-204
+        { 0xef340a98172aace5ULL,  -715 }, // 1e-196
+        { 0xb23867fb2a35b28eULL,  -688 }, // 1e-188
+        { 0x84c8d4dfd2c63f3bULL,  -661 }, // 1e-180
+        { 0xc5dd44271ad3cdbaULL,  -635 }, // 1e-172
+        { 0x936b9fcebb25c996ULL,  -608 }, // 1e-164
+        { 0xdbac6c247d62a584ULL,  -582 }, // 1e-156
+        { 0xa3ab66580d5fdaf6ULL,  -555 }, // 1e-148
+        { 0xf3e2f893dec3f126ULL,  -529 }, // 1e-140
+        { 0xb5b5ada8aaff80b8ULL,  -502 }, // 1e-132
+        { 0x87625f056c7c4a8bULL,  -475 }, // 1e-124
+        { 0xc9bcff6034c13053ULL,  -449 }, // 1e-116
+        { 0x964e858c91ba2655ULL,  -422 }, // 1e-108
+        { 0xdff9772470297ebdULL,  -396 }, // 1e-100
+        { 0xa6dfbd9fb8e5b88fULL,  -369 }, // 1e-92
+        { 0xf8a95fcf88747d94ULL,  -343 }, // 1e-84
+        { 0xb94470938fa89bcfULL,  -316 }, // 1e-76
+        { 0x8a08f0f8bf0f156bULL,  -289 }, // 1e-68
+        { 0xcdb02555653131b6ULL,  -263 }, // 1e-60
+        { 0x993fe2c6d07b7facULL,  -236 }, // 1e-52
+        { 0xe45c10c42a2b3b06ULL,  -210 }, // 1e-44
+        { 0xaa242499697392d3ULL,  -183 }, // 1e-36
+        { 0xfd87b5f28300ca0eULL,  -157 }, // 1e-28
+        { 0xbce5086492111aebULL,  -130 }, // 1e-20
+        { 0x8cbccc096f5088ccULL,  -103 }, // 1e-12
+        { 0xd1b71758e219652cULL,   -77 }, // 1e-4
+        { 0x9c40000000000000ULL,   -50 }, // 1e4
+        { 0xe8d4a51000000000ULL,   -24 }, // 1e12
+        { 0xad78ebc5ac620000ULL,     3 }, // 1e20
+        { 0x813f3978f8940984ULL,    30 }, // 1e28
+        { 0xc097ce7bc90715b3ULL,    56 }, // 1e36
+        { 0x8f7e32ce7bea5c70ULL,    83 }, // 1e44
+        { 0xd5d238a4abe98068ULL,   109 }, // 1e52
+        { 0x9f4f2726179a2245ULL,   136 }, // 1e60
+        { 0xed63a231d4c4fb27ULL,   162 }, // 1e68
+        { 0xb0de65388cc8ada8ULL,   189 }, // 1e76
+        { 0x83c7088e1aab65dbULL,   216 }, // 1e84
+        { 0xc45d1df942711d9aULL,   242 }, // 1e92
+        { 0x924d692ca61be758ULL,   269 }, // 1e100
+        { 0xda01ee641a708deaULL,   295 }, // 1e108
+        { 0xa26da3999aef774aULL,   322 }, // 1e116
+        { 0xf209787bb47d6b85ULL,   348 }, // 1e124
+        { 0xb454e4a179dd1877ULL,   375 }, // 1e132
+        { 0x865b86925b9bc5c2ULL,   402 }, // 1e140
+        { 0xc83553c5c8965d3dULL,   428 }, // 1e148
+        { 0x952ab45cfa97a0b3ULL,   455 }, // 1e156
+        { 0xde469fbd99a05fe3ULL,   481 }, // 1e164
+        { 0xa59bc234db398c25ULL,   508 }, // 1e172
+        { 0xf6c69a72a3989f5cULL,   534 }, // 1e180
+        { 0xb7dcbf5354e9beceULL,   561 }, // 1e188
+        { 0x88fcf317f22241e2ULL,   588 }, // 1e196
+        { 0xcc20ce9bd35c78a5ULL,   614 }, // 1e204
+        { 0x98165af37b2153dfULL,   641 }, // 1e212
+        { 0xe2a0b5dc971f303aULL,   667 }, // 1e220
+        { 0xa8d9d1535ce3b396ULL,   694 }, // 1e228
+        { 0xfb9b7cd9a4a7443cULL,   720 }, // 1e236
+        { 0xbb764c4ca7a44410ULL,   747 }, // 1e244
+        { 0x8bab8eefb6409c1aULL,   774 }, // 1e252
+        { 0xd01fef10a657842cULL,   800 }, // 1e260
+        { 0x9b10a4e5e9913129ULL,   827 }, // 1e268
+        { 0xe7109bfba19c0c9dULL,   853 }, // 1e276
+        { 0xac2820d9623bf429ULL,   880 }, // 1e284
+        { 0x80444b5e7aa7cf85ULL,   907 }, // 1e292
+        { 0xbf21e44003acdd2dULL,   933 }, // 1e300
+        { 0x8e679c2f5e44ff8fULL,   960 }, // 1e308
+        { 0xd433179d9c8cb841ULL,   986 }, // 1e316
+        { 0x9e19db92b4e31ba9ULL,  1013 }, // 1e324
+        { 0xeb96bf6ebadf77d9ULL,  1039 }, // 1e332
+        { 0xaf87023b9bf0ee6bULL,  1066 } // 1e340
+    };
+    
+    static const uint64_t sPowersOf10[] =
+    {
+        1ULL,
+        10ULL,
+        100ULL,
+        1000ULL,
+        10000ULL,
+        100000ULL,
+        1000000ULL,
+        10000000ULL,
+        100000000ULL,
+        1000000000ULL,
+        10000000000ULL,
+        100000000000ULL,
+        1000000000000ULL,
+        10000000000000ULL,
+        100000000000000ULL,
+        1000000000000000ULL,
+        10000000000000000ULL,
+        100000000000000000ULL,
+        1000000000000000000ULL,
+        10000000000000000000ULL
+    };
+    
+    // Finds a cached power of ten that scales a number with binary exponent
+    // `e` into the range DigitGenerate() works in. Returns the negated decimal
+    // exponent of the power in `k`.
+    static DiyFp CachedPowerFor(int e, int * k)
+    {
+        // log10(2) ~ 0.30103. Adding 347 keeps the result positive.
+        double dk = (-61 - e) * 0.30102999566398114 + 347;
+        int exponent = static_cast<int>(dk);
+        if (dk - exponent > 0.0) exponent++;
+        
+        int index = (exponent >> 3) + 1;
+        *k = -(-348 + index * 8);
+        
+        return DiyFp(sCachedPowers[index].f, sCachedPowers[index].e);
+    }
+    
+    // Nudges the last digit down while that moves it closer to the exact
+    // value and stays inside the range that reads back correctly.
+    static void Round(char * buffer, int length, uint64_t delta, uint64_t rest,
+                      uint64_t tenKappa, uint64_t distance)
+    {
+        while ((rest < distance) && (delta - rest >= tenKappa) &&
+               ((rest + tenKappa < distance) ||
+                (distance - rest > rest + tenKappa - distance)))
+        {
+            buffer[length - 1]--;
+            rest += tenKappa;
+        }
+    }
+    
+    static int CountDigits(uint32_t value)
+    {
+        int digits = 1;
+        while ((digits < 10) && (value >= sPowersOf10[digits])) digits++;
+        return digits;
+    }
+    
+    // Generates the shortest digits for `w` that lie within `delta` of the
+    // upper boundary `upper`. Adjusts `k` by the decimal exponent of the last
+    // digit generated.
+    static void DigitGenerate(const DiyFp & w, const DiyFp & upper,
+                              uint64_t delta, char * buffer, int * length,
+                              int * k)
+    {
+        const DiyFp one(1ULL << -upper.e, upper.e);
+        const DiyFp distance = upper - w;
+        
+        // Split the upper boundary into integer and fractional parts.
+        uint32_t integral = static_cast<uint32_t>(upper.f >> -one.e);
+        uint64_t fraction = upper.f & (one.f - 1);
+        
+        int kappa = CountDigits(integral);
+        *length = 0;
+        
+        while (kappa > 0)
+        {
+            uint32_t divisor = static_cast<uint32_t>(sPowersOf10[kappa - 1]);
+            uint32_t digit = integral / divisor;
+            integral %= divisor;
+            
+            if ((digit != 0) || (*length != 0))
+            {
+                buffer[(*length)++] = static_cast<char>('0' + digit);
+            }
+            
+            kappa--;
+            
+            uint64_t rest = (static_cast<uint64_t>(integral) << -one.e) + fraction;
+            if (rest <= delta)
+            {
+                *k += kappa;
+                Round(buffer, *length, delta, rest,
+                      sPowersOf10[kappa] << -one.e, distance.f);
+                return;
+            }
+        }
+        
+        while (true)
+        {
+            fraction *= 10;
+            delta *= 10;
+            
+            char digit = static_cast<char>(fraction >> -one.e);
+            if ((digit != 0) || (*length != 0))
+            {
+                buffer[(*length)++] = static_cast<char>('0' + digit);
+            }
+            
+            fraction &= one.f - 1;
+            kappa--;
+            
+            if (fraction < delta)
+            {
+                *k += kappa;
+                int index = -kappa;
+                Round(buffer, *length, delta, fraction, one.f,
+                      distance.f * ((index < 20) ? sPowersOf10[index] : 0));
+                return;
+            }
+        }
+    }
+    
+    // Writes the shortest digits for a positive, finite value to buffer and
+    // returns how many there are. The value is digits * 10^k.
+    static int Grisu2(double value, char * buffer, int * k)
+    {
+        const DiyFp v(value);
+        DiyFp minus;
+        DiyFp plus;
+        v.NormalizedBoundaries(&minus, &plus);
+        
+        const DiyFp power = CachedPowerFor(plus.e, k);
+        const DiyFp w = v.Normalize() * power;
+        DiyFp upper = plus * power;
+        DiyFp lower = minus * power;
+        
+        // Stay strictly inside the boundaries since the multiplications above
+        // may be off by one.
+        lower.f++;
+        upper.f--;
+        
+        int length;
+        DigitGenerate(w, upper, upper.f - lower.f, buffer, &length, k);
+        return length;
+    }
+    
+    static int WriteInteger(uint64_t value, char * buffer)
+    {
+        // Write the digits backwards, then flip them around.
+        int length = 0;
+        do
+        {
+            buffer[length++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        while (value != 0);
+        
+        for (int i = 0; i < length / 2; i++)
+        {
+            char c = buffer[i];
+            buffer[i] = buffer[length - 1 - i];
+            buffer[length - 1 - i] = c;
+        }
+        
+        return length;
+    }
+    
+    // Lays out `length` digits scaled by 10^k in decimal or exponent notation.
+    static int Prettify(char * buffer, int length, int k)
+    {
+        // Where the decimal point goes, relative to the first digit.
+        int point = length + k;
+        
+        if ((length <= point) && (point <= 21))
+        {
+            // An integer too big for the fast path, like 1e20.
+            memset(buffer + length, '0', point - length);
+            return point;
+        }
+        
+        if ((0 < point) && (point <= 21))
+        {
+            // 1234e-2 -> 12.34
+            memmove(buffer + point + 1, buffer + point, length - point);
+            buffer[point] = '.';
+            return length + 1;
+        }
+        
+        if ((-6 < point) && (point <= 0))
+        {
+            // 1234e-6 -> 0.001234
+            int zeros = -point;
+            memmove(buffer + 2 + zeros, buffer, length);
+            buffer[0] = '0';
+            buffer[1] = '.';
+            memset(buffer + 2, '0', zeros);
+            return length + 2 + zeros;
+        }
+        
+        // 1234e30 -> 1.234e+33
+        int end = length;
+        if (length > 1)
+        {
+            memmove(buffer + 2, buffer + 1, length - 1);
+            buffer[1] = '.';
+            end++;
+        }
+        
+        int exponent = point - 1;
+        buffer[end++] = 'e';
+        buffer[end++] = (exponent < 0) ? '-' : '+';
+        if (exponent < 0) exponent = -exponent;
+        
+        return end + WriteInteger(static_cast<uint64_t>(exponent), buffer + end);
+    }
+    
+    int NumberFormat::Format(double value, char * buffer)
+    {
+        int length = 0;
+        
+        if (value != value)
+        {
+            strcpy(buffer, "nan");
+            return 3;
+        }
+        
+        if (std::signbit(value))
+        {
+            buffer[length++] = '-';
+            value = -value;
+        }
+        
+        if (value == HUGE_VAL)
+        {
+            strcpy(buffer + length, "inf");
+            return length + 3;
+        }
+        
+        // Most numbers in practice are integers small enough to be exact, so
+        // skip the general algorithm for them.
+        if ((value < 9007199254740992.0) && (value == floor(value)))
+        {
+            length += WriteInteger(static_cast<uint64_t>(value), buffer + length);
+        }
+        else
+        {
+            int k;
+            int digits = Grisu2(value, buffer + length, &k);
+            length += Prettify(buffer + length, digits, k);
+        }
+        
+        buffer[length] = '\0';
+        return length;
+    }
+    
+    String NumberFormat::ToString(double value)
+    {
+        char buffer[MaxLength];
+        Format(value, buffer);
+        return String(buffer);
+    }
+    
+    void NumberFormat::Write(ostream & stream, double value)
+    {
+        char buffer[MaxLength];
+        Format(value, buffer);
+        stream << buffer;
+    }
+}
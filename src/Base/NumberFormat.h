@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+
+#include "FinchString.h"
+
+namespace Finch
+{
+    using std::ostream;
+    
+    // Converts numbers to text using the fewest digits that still read back
+    // as exactly the same double. Integers are written out directly. Other
+    // values use Florian Loitsch's Grisu2 algorithm, which only needs 64-bit
+    // integer arithmetic. Very large and very small magnitudes use exponent
+    // notation, like "1e+21" and "1e-7".
+    class NumberFormat
+    {
+    public:
+        // The most characters Format() will write, including the terminator.
+        static const int MaxLength = 32;
+        
+        // Writes the text for the given number and a terminator to buffer,
+        // which must have room for MaxLength characters. Returns the number
+        // of characters written, not counting the terminator.
+        static int Format(double value, char * buffer);
+        
+        static String ToString(double value);
+        
+        static void Write(ostream & stream, double value);
+    };
+}
+
@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FINCH_SIMD_NUMBERS
+#include <immintrin.h>
+#endif
+
+#include "NumberKernels.h"
+
+namespace Finch
+{
+    typedef double (*ReduceFunction)(const double * values, int count);
+    typedef double (*DotFunction)(const double * left, const double * right,
+                                  int count);
+    typedef void (*ArrayFunction)(const double * left, const double * right,
+                                  double * result, int count);
+    typedef void (*NumberFunction)(const double * left, double right,
+                                   double * result, int count);
+
+    // The kernels for the instructions this CPU supports.
+    struct KernelTable
+    {
+        ReduceFunction sum;
+        ReduceFunction min;
+        ReduceFunction max;
+        DotFunction    dot;
+        ArrayFunction  add;
+        NumberFunction addNumber;
+        ArrayFunction  multiply;
+        NumberFunction multiplyNumber;
+    };
+
+    // The reductions all work the same way: element i goes into partial
+    // result i % 8, and then the partial results are combined pairwise as
+    // ((0 4) (2 6)) ((1 5) (3 7)). That's the order that falls out of
+    // adding two SSE2 or AVX registers' halves together, so the scalar code
+    // does the same to get identical results. Elements left over after the
+    // last full group of eight are folded in one at a time.
+
+    static inline double MinOf(double left, double right)
+    {
+        // Same as minpd: if either is NaN, the right one is returned.
+        return (left < right) ? left : right;
+    }
+
+    static inline double MaxOf(double left, double right)
+    {
+        return (left > right) ? left : right;
+    }
+
+    static inline double Infinity()
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    // The reductions seed min and max with infinity, so that NaNs are never
+    // picked. If that's all that comes out, there was either nothing but
+    // NaNs or a real infinity.
+    static double FixEmptyExtreme(const double * values, int count,
+                                  double result, double seed)
+    {
+        if (result != seed) return result;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (values[i] == seed) return seed;
+        }
+
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    static double SumScalar(const double * values, int count)
+    {
+        double partial[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            for (int lane = 0; lane < 8; lane++) partial[lane] += values[i + lane];
+        }
+
+        double result = ((partial[0] + partial[4]) + (partial[2] + partial[6])) +
+                        ((partial[1] + partial[5]) + (partial[3] + partial[7]));
+        for (; i < count; i++) result += values[i];
+
+        return result;
+    }
+
+    static double MinScalar(const double * values, int count)
+    {
+        double partial[8];
+        for (int lane = 0; lane < 8; lane++) partial[lane] = Infinity();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            for (int lane = 0; lane < 8; lane++)
+            {
+                partial[lane] = MinOf(values[i + lane], partial[lane]);
+            }
+        }
+
+        double result = MinOf(
+            MinOf(MinOf(partial[0], partial[4]), MinOf(partial[2], partial[6])),
+            MinOf(MinOf(partial[1], partial[5]), MinOf(partial[3], partial[7])));
+        for (; i < count; i++) result = MinOf(values[i], result);
+
+        return result;
+    }
+
+    static double MaxScalar(const double * values, int count)
+    {
+        double partial[8];
+        for (int lane = 0; lane < 8; lane++) partial[lane] = -Infinity();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            for (int lane = 0; lane < 8; lane++)
+            {
+                partial[lane] = MaxOf(values[i + lane], partial[lane]);
+            }
+        }
+
+        double result = MaxOf(
+            MaxOf(MaxOf(partial[0], partial[4]), MaxOf(partial[2], partial[6])),
+            MaxOf(MaxOf(partial[1], partial[5]), MaxOf(partial[3], partial[7])));
+        for (; i < count; i++) result = MaxOf(values[i], result);
+
+        return result;
+    }
+
+    static double DotScalar(const double * left, const double * right,
+                            int count)
+    {
+        double partial[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            for (int lane = 0; lane < 8; lane++)
+            {
+                partial[lane] += left[i + lane] * right[i + lane];
+            }
+        }
+
+        double result = ((partial[0] + partial[4]) + (partial[2] + partial[6])) +
+                        ((partial[1] + partial[5]) + (partial[3] + partial[7]));
+        for (; i < count; i++) result += left[i] * right[i];
+
+        return result;
+    }
+
+    static void AddScalar(const double * left, const double * right,
+                          double * result, int count)
+    {
+        for (int i = 0; i < count; i++) result[i] = left[i] + right[i];
+    }
+
+    static void AddNumberScalar(const double * left, double right,
+                                double * result, int count)
+    {
+        for (int i = 0; i < count; i++) result[i] = left[i] + right;
+    }
+
+    static void MultiplyScalar(const double * left, const double * right,
+                               double * result, int count)
+    {
+        for (int i = 0; i < count; i++) result[i] = left[i] * right[i];
+    }
+
+    static void MultiplyNumberScalar(const double * left, double right,
+                                     double * result, int count)
+    {
+        for (int i = 0; i < count; i++) result[i] = left[i] * right;
+    }
+
+#ifdef FINCH_SIMD_NUMBERS
+    // Combines four SSE2 registers of partial results, holding lanes 0-1,
+    // 2-3, 4-5 and 6-7, in the standard order.
+    __attribute__((target("sse2")))
+    static inline __m128d CombineSse2(__m128d a, __m128d b, __m128d c,
+                                      __m128d d)
+    {
+        return _mm_add_pd(_mm_add_pd(a, c), _mm_add_pd(b, d));
+    }
+
+    __attribute__((target("sse2")))
+    static inline double HorizontalAdd(__m128d pair)
+    {
+        return _mm_cvtsd_f64(pair) + _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair));
+    }
+
+    __attribute__((target("sse2")))
+    static double SumSse2(const double * values, int count)
+    {
+        __m128d a = _mm_setzero_pd();
+        __m128d b = _mm_setzero_pd();
+        __m128d c = _mm_setzero_pd();
+        __m128d d = _mm_setzero_pd();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            a = _mm_add_pd(a, _mm_loadu_pd(values + i));
+            b = _mm_add_pd(b, _mm_loadu_pd(values + i + 2));
+            c = _mm_add_pd(c, _mm_loadu_pd(values + i + 4));
+            d = _mm_add_pd(d, _mm_loadu_pd(values + i + 6));
+        }
+
+        double result = HorizontalAdd(CombineSse2(a, b, c, d));
+        for (; i < count; i++) result += values[i];
+
+        return result;
+    }
+
+    __attribute__((target("sse2")))
+    static double MinSse2(const double * values, int count)
+    {
+        __m128d a = _mm_set1_pd(Infinity());
+        __m128d b = a;
+        __m128d c = a;
+        __m128d d = a;
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            a = _mm_min_pd(_mm_loadu_pd(values + i), a);
+            b = _mm_min_pd(_mm_loadu_pd(values + i + 2), b);
+            c = _mm_min_pd(_mm_loadu_pd(values + i + 4), c);
+            d = _mm_min_pd(_mm_loadu_pd(values + i + 6), d);
+        }
+
+        __m128d pair = _mm_min_pd(_mm_min_pd(a, c), _mm_min_pd(b, d));
+        double result = MinOf(_mm_cvtsd_f64(pair),
+                              _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair)));
+        for (; i < count; i++) result = MinOf(values[i], result);
+
+        return result;
+    }
+
+    __attribute__((target("sse2")))
+    static double MaxSse2(const double * values, int count)
+    {
+        __m128d a = _mm_set1_pd(-Infinity());
+        __m128d b = a;
+        __m128d c = a;
+        __m128d d = a;
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            a = _mm_max_pd(_mm_loadu_pd(values + i), a);
+            b = _mm_max_pd(_mm_loadu_pd(values + i + 2), b);
+            c = _mm_max_pd(_mm_loadu_pd(values + i + 4), c);
+            d = _mm_max_pd(_mm_loadu_pd(values + i + 6), d);
+        }
+
+        __m128d pair = _mm_max_pd(_mm_max_pd(a, c), _mm_max_pd(b, d));
+        double result = MaxOf(_mm_cvtsd_f64(pair),
+                              _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair)));
+        for (; i < count; i++) result = MaxOf(values[i], result);
+
+        return result;
+    }
+
+    __attribute__((target("sse2")))
+    static double DotSse2(const double * left, const double * right, int count)
+    {
+        __m128d a = _mm_setzero_pd();
+        __m128d b = _mm_setzero_pd();
+        __m128d c = _mm_setzero_pd();
+        __m128d d = _mm_setzero_pd();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            a = _mm_add_pd(a, _mm_mul_pd(_mm_loadu_pd(left + i),
+                                         _mm_loadu_pd(right + i)));
+            b = _mm_add_pd(b, _mm_mul_pd(_mm_loadu_pd(left + i + 2),
+                                         _mm_loadu_pd(right + i + 2)));
+            c = _mm_add_pd(c, _mm_mul_pd(_mm_loadu_pd(left + i + 4),
+                                         _mm_loadu_pd(right + i + 4)));
+            d = _mm_add_pd(d, _mm_mul_pd(_mm_loadu_pd(left + i + 6),
+                                         _mm_loadu_pd(right + i + 6)));
+        }
+
+        double result = HorizontalAdd(CombineSse2(a, b, c, d));
+        for (; i < count; i++) result += left[i] * right[i];
+
+        return result;
+    }
+
+    __attribute__((target("sse2")))
+    static void AddSse2(const double * left, const double * right,
+                        double * result, int count)
+    {
+        int i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            _mm_storeu_pd(result + i, _mm_add_pd(_mm_loadu_pd(left + i),
+                                                 _mm_loadu_pd(right + i)));
+        }
+
+        AddScalar(left + i, right + i, result + i, count - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void AddNumberSse2(const double * left, double right,
+                              double * result, int count)
+    {
+        const __m128d scalar = _mm_set1_pd(right);
+
+        int i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            _mm_storeu_pd(result + i, _mm_add_pd(_mm_loadu_pd(left + i), scalar));
+        }
+
+        AddNumberScalar(left + i, right, result + i, count - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void MultiplySse2(const double * left, const double * right,
+                             double * result, int count)
+    {
+        int i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            _mm_storeu_pd(result + i, _mm_mul_pd(_mm_loadu_pd(left + i),
+                                                 _mm_loadu_pd(right + i)));
+        }
+
+        MultiplyScalar(left + i, right + i, result + i, count - i);
+    }
+
+    __attribute__((target("sse2")))
+    static void MultiplyNumberSse2(const double * left, double right,
+                                   double * result, int count)
+    {
+        const __m128d scalar = _mm_set1_pd(right);
+
+        int i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            _mm_storeu_pd(result + i, _mm_mul_pd(_mm_loadu_pd(left + i), scalar));
+        }
+
+        MultiplyNumberScalar(left + i, right, result + i, count - i);
+    }
+
+    // The AVX reductions keep lanes 0-3 and 4-7 in two registers. Adding
+    // them and then adding the halves of that gives the standard order.
+    __attribute__((target("avx")))
+    static inline __m128d CombineAvx(__m256d low, __m256d high)
+    {
+        __m256d both = _mm256_add_pd(low, high);
+        return _mm_add_pd(_mm256_castpd256_pd128(both),
+                          _mm256_extractf128_pd(both, 1));
+    }
+
+    __attribute__((target("avx")))
+    static double SumAvx(const double * values, int count)
+    {
+        __m256d low = _mm256_setzero_pd();
+        __m256d high = _mm256_setzero_pd();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            low  = _mm256_add_pd(low,  _mm256_loadu_pd(values + i));
+            high = _mm256_add_pd(high, _mm256_loadu_pd(values + i + 4));
+        }
+
+        double result = HorizontalAdd(CombineAvx(low, high));
+        for (; i < count; i++) result += values[i];
+
+        return result;
+    }
+
+    __attribute__((target("avx")))
+    static double MinAvx(const double * values, int count)
+    {
+        __m256d low = _mm256_set1_pd(Infinity());
+        __m256d high = low;
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            low  = _mm256_min_pd(_mm256_loadu_pd(values + i), low);
+            high = _mm256_min_pd(_mm256_loadu_pd(values + i + 4), high);
+        }
+
+        __m256d both = _mm256_min_pd(low, high);
+        __m128d pair = _mm_min_pd(_mm256_castpd256_pd128(both),
+                                  _mm256_extractf128_pd(both, 1));
+        double result = MinOf(_mm_cvtsd_f64(pair),
+                              _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair)));
+        for (; i < count; i++) result = MinOf(values[i], result);
+
+        return result;
+    }
+
+    __attribute__((target("avx")))
+    static double MaxAvx(const double * values, int count)
+    {
+        __m256d low = _mm256_set1_pd(-Infinity());
+        __m256d high = low;
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            low  = _mm256_max_pd(_mm256_loadu_pd(values + i), low);
+            high = _mm256_max_pd(_mm256_loadu_pd(values + i + 4), high);
+        }
+
+        __m256d both = _mm256_max_pd(low, high);
+        __m128d pair = _mm_max_pd(_mm256_castpd256_pd128(both),
+                                  _mm256_extractf128_pd(both, 1));
+        double result = MaxOf(_mm_cvtsd_f64(pair),
+                              _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair)));
+        for (; i < count; i++) result = MaxOf(values[i], result);
+
+        return result;
+    }
+
+    __attribute__((target("avx")))
+    static double DotAvx(const double * left, const double * right, int count)
+    {
+        __m256d low = _mm256_setzero_pd();
+        __m256d high = _mm256_setzero_pd();
+
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            low  = _mm256_add_pd(low,  _mm256_mul_pd(
+                _mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+            high = _mm256_add_pd(high, _mm256_mul_pd(
+                _mm256_loadu_pd(left + i + 4), _mm256_loadu_pd(right + i + 4)));
+        }
+
+        double result = HorizontalAdd(CombineAvx(low, high));
+        for (; i < count; i++) result += left[i] * right[i];
+
+        return result;
+    }
+
+    __attribute__((target("avx")))
+    static void AddAvx(const double * left, const double * right,
+                       double * result, int count)
+    {
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm256_storeu_pd(result + i, _mm256_add_pd(
+                _mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+        }
+
+        AddScalar(left + i, right + i, result + i, count - i);
+    }
+
+    __attribute__((target("avx")))
+    static void AddNumberAvx(const double * left, double right,
+                             double * result, int count)
+    {
+        const __m256d scalar = _mm256_set1_pd(right);
+
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm256_storeu_pd(result + i, _mm256_add_pd(
+                _mm256_loadu_pd(left + i), scalar));
+        }
+
+        AddNumberScalar(left + i, right, result + i, count - i);
+    }
+
+    __attribute__((target("avx")))
+    static void MultiplyAvx(const double * left, const double * right,
+                            double * result, int count)
+    {
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm256_storeu_pd(result + i, _mm256_mul_pd(
+                _mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+        }
+
+        MultiplyScalar(left + i, right + i, result + i, count - i);
+    }
+
+    __attribute__((target("avx")))
+    static void MultiplyNumberAvx(const double * left, double right,
+                                  double * result, int count)
+    {
+        const __m256d scalar = _mm256_set1_pd(right);
+
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm256_storeu_pd(result + i, _mm256_mul_pd(
+                _mm256_loadu_pd(left + i), scalar));
+        }
+
+        MultiplyNumberScalar(left + i, right, result + i, count - i);
+    }
+#endif
+
+    // Picks the fastest kernels this CPU supports.
+    static KernelTable ChooseKernels()
+    {
+        KernelTable table;
+        table.sum            = SumScalar;
+        table.min            = MinScalar;
+        table.max            = MaxScalar;
+        table.dot            = DotScalar;
+        table.add            = AddScalar;
+        table.addNumber      = AddNumberScalar;
+        table.multiply       = MultiplyScalar;
+        table.multiplyNumber = MultiplyNumberScalar;
+
+#ifdef FINCH_SIMD_NUMBERS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx"))
+        {
+            table.sum            = SumAvx;
+            table.min            = MinAvx;
+            table.max            = MaxAvx;
+            table.dot            = DotAvx;
+            table.add            = AddAvx;
+            table.addNumber      = AddNumberAvx;
+            table.multiply       = MultiplyAvx;
+            table.multiplyNumber = MultiplyNumberAvx;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+            table.sum            = SumSse2;
+            table.min            = MinSse2;
+            table.max            = MaxSse2;
+            table.dot            = DotSse2;
+            table.add            = AddSse2;
+            table.addNumber      = AddNumberSse2;
+            table.multiply       = MultiplySse2;
+            table.multiplyNumber = MultiplyNumberSse2;
+        }
+#endif
+
+        return table;
+    }
+
+    static const KernelTable & Kernels()
+    {
+        static const KernelTable table = ChooseKernels();
+        return table;
+    }
+
+    double NumberKernels::Sum(const double * values, int count)
+    {
+        return Kernels().sum(values, count);
+    }
+
+    double NumberKernels::Min(const double * values, int count)
+    {
+        double result = Kernels().min(values, count);
+        return FixEmptyExtreme(values, count, result, Infinity());
+    }
+
+    double NumberKernels::Max(const double * values, int count)
+    {
+        double result = Kernels().max(values, count);
+        return FixEmptyExtreme(values, count, result, -Infinity());
+    }
+
+    double NumberKernels::Dot(const double * left, const double * right,
+                              int count)
+    {
+        return Kernels().dot(left, right, count);
+    }
+
+    void NumberKernels::Add(const double * left, const double * right,
+                            double * result, int count)
+    {
+        Kernels().add(left, right, result, count);
+    }
+
+    void NumberKernels::Add(const double * left, double right,
+                            double * result, int count)
+    {
+        Kernels().addNumber(left, right, result, count);
+    }
+
+    void NumberKernels::Multiply(const double * left, const double * right,
+                                 double * result, int count)
+    {
+        Kernels().multiply(left, right, result, count);
+    }
+
+    void NumberKernels::Multiply(const double * left, double right,
+                                 double * result, int count)
+    {
+        Kernels().multiplyNumber(left, right, result, count);
+    }
+
+    static bool IsNotNaN(double value)
+    {
+        return value == value;
+    }
+
+    void NumberKernels::Sort(double * values, int count)
+    {
+        // NaNs don't compare, so std::sort() can't handle them. Move them out
+        // of the way first.
+        double * end = std::partition(values, values + count, IsNotNaN);
+        std::sort(values, end);
+    }
+}
+
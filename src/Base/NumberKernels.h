@@ -0,0 +1,37 @@
+#pragma once
+
+namespace Finch
+{
+    // Bulk operations on packed arrays of doubles, used by number arrays.
+    // These use SSE2 or AVX when the CPU has them. The reductions keep eight
+    // partial results and combine them in a fixed order, so they give the
+    // same answer whichever instructions are used, though it may differ in
+    // the last bits from adding the values up one at a time.
+    class NumberKernels
+    {
+    public:
+        static double Sum(const double * values, int count);
+
+        // Min() and Max() skip NaNs. If count is zero or every value is NaN,
+        // they return NaN.
+        static double Min(const double * values, int count);
+        static double Max(const double * values, int count);
+
+        static double Dot(const double * left, const double * right, int count);
+
+        // The element-wise operations write to result, which may be the same
+        // array as left.
+        static void Add(const double * left, const double * right,
+                        double * result, int count);
+        static void Add(const double * left, double right,
+                        double * result, int count);
+        static void Multiply(const double * left, const double * right,
+                             double * result, int count);
+        static void Multiply(const double * left, double right,
+                             double * result, int count);
+
+        // Sorts in ascending order with any NaNs at the end.
+        static void Sort(double * values, int count);
+    };
+}
+
@@ -40,6 +40,16 @@ namespace Finch
             }
         }
         
+        // Moves a reference. This takes the other reference's place in the
+        // list of references to the object, and leaves it null.
+        Ref(Ref<T> && other)
+        :   mObj(NULL),
+            mPrev(this),
+            mNext(this)
+        {
+            Take(other);
+        }
+        
         ~Ref() { Clear(); }
 
         T & operator *() const { return *mObj; }
@@ -72,9 +82,25 @@ namespace Finch
             return *this;
         }
         
+        // Discards the currently referred to object and moves the given
+        // reference into this one.
+        Ref<T>& operator =(Ref<T> && other)
+        {
+            if (&other != this)
+            {
+                Clear();
+                Take(other);
+            }
+            
+            return *this;
+        }
+        
         // Gets whether or not this reference is pointing to null.
         bool IsNull() const { return mObj == NULL; }
         
+        // Gets whether or not this is the only reference to its object.
+        bool IsUnique() const { return (mObj != NULL) && (mNext == this); }
+        
         // Clears the reference. If this was the last reference to the referred
         // object, it will be deallocated.
         void Clear()
@@ -115,6 +141,24 @@ namespace Finch
             }
         }
         
+        void Take(Ref<T> & other)
+        {
+            mObj = other.mObj;
+            other.mObj = NULL;
+            
+            // swap it into other's place in the list
+            if (other.mNext != &other)
+            {
+                mPrev = other.mPrev;
+                mNext = other.mNext;
+                mPrev->mNext = this;
+                mNext->mPrev = this;
+                
+                other.mPrev = &other;
+                other.mNext = &other;
+            }
+        }
+        
         T * mObj;
         
         mutable const Ref<T> * mPrev;
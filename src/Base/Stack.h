@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <utility>
 
 #include "Array.h"
 #include "Macros.h"
@@ -30,12 +31,18 @@ namespace Finch
             mItems.Add(item);
         }
         
+        // Moves the given item onto the top of the stack.
+        void Push(T && item)
+        {
+            mItems.Add(std::move(item));
+        }
+        
         // Pops the top item off the stack.
         T Pop()
         {
             ASSERT(!IsEmpty(), "Cannot pop an empty stack.");
             
-            T popped = mItems[-1];
+            T popped = std::move(mItems[-1]);
             mItems.RemoveAt(-1);
             
             return popped;
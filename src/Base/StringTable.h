@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Array.h"
+#include "Dictionary.h"
 #include "FinchString.h"
 
 namespace Finch
@@ -11,6 +12,8 @@ namespace Finch
     class StringTable
     {
     public:
+        StringTable() {}
+        
         // Adds the given string to the table if not already present, and
         // returns its ID.
         StringId Add(const String & string);
@@ -20,6 +23,11 @@ namespace Finch
         
     private:
         Array<String> mStrings;
+        
+        // Maps strings to their IDs.
+        Dictionary<String, StringId> mIds;
+        
+        NO_COPY(StringTable);
     };
 }
 
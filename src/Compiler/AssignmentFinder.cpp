@@ -0,0 +1,142 @@
+#include "ArrayExpr.h"
+#include "AssignmentFinder.h"
+#include "BindExpr.h"
+#include "BlockExpr.h"
+#include "MessageExpr.h"
+#include "ObjectExpr.h"
+#include "ReturnExpr.h"
+#include "SequenceExpr.h"
+#include "SetExpr.h"
+#include "VarExpr.h"
+
+namespace Finch
+{
+    void AssignmentFinder::Find(const Array<String> & params, const Expr & body,
+                                Array<String> & outNames)
+    {
+        AssignmentFinder finder(params, outNames);
+        body.Accept(finder, 0);
+    }
+
+    AssignmentFinder::AssignmentFinder(const Array<String> & params,
+                                       Array<String> & names)
+    :   mDepth(0),
+        mDeclared(params),
+        mReassigned(names)
+    {}
+
+    void AssignmentFinder::Visit(const ArrayExpr & expr, int dest)
+    {
+        for (int i = 0; i < expr.Elements().Count(); i++)
+        {
+            expr.Elements()[i]->Accept(*this, dest);
+        }
+    }
+
+    void AssignmentFinder::Visit(const BindExpr & expr, int dest)
+    {
+        expr.Target()->Accept(*this, dest);
+        VisitDefinitions(expr);
+    }
+
+    void AssignmentFinder::Visit(const BlockExpr & expr, int dest)
+    {
+        // Variables declared inside the nested block are its own, but it can
+        // still assign to ours.
+        mDepth++;
+        expr.Body()->Accept(*this, dest);
+        mDepth--;
+    }
+
+    void AssignmentFinder::Visit(const MessageExpr & expr, int dest)
+    {
+        expr.Receiver()->Accept(*this, dest);
+
+        for (int i = 0; i < expr.Messages().Count(); i++)
+        {
+            const Array<Ref<Expr> > & args = expr.Messages()[i].GetArguments();
+            for (int j = 0; j < args.Count(); j++)
+            {
+                args[j]->Accept(*this, dest);
+            }
+        }
+    }
+
+    void AssignmentFinder::Visit(const NameExpr & expr, int dest)
+    {
+    }
+
+    void AssignmentFinder::Visit(const NumberExpr & expr, int dest)
+    {
+    }
+
+    void AssignmentFinder::Visit(const ObjectExpr & expr, int dest)
+    {
+        expr.Parent()->Accept(*this, dest);
+        VisitDefinitions(expr);
+    }
+
+    void AssignmentFinder::Visit(const ReturnExpr & expr, int dest)
+    {
+        expr.Result()->Accept(*this, dest);
+    }
+
+    void AssignmentFinder::Visit(const SequenceExpr & expr, int dest)
+    {
+        for (int i = 0; i < expr.Expressions().Count(); i++)
+        {
+            expr.Expressions()[i]->Accept(*this, dest);
+        }
+    }
+
+    void AssignmentFinder::Visit(const SelfExpr & expr, int dest)
+    {
+    }
+
+    void AssignmentFinder::Visit(const SetExpr & expr, int dest)
+    {
+        AddReassigned(expr.Name());
+        expr.Value()->Accept(*this, dest);
+    }
+
+    void AssignmentFinder::Visit(const StringExpr & expr, int dest)
+    {
+    }
+
+    void AssignmentFinder::Visit(const UndefineExpr & expr, int dest)
+    {
+    }
+
+    void AssignmentFinder::Visit(const VarExpr & expr, int dest)
+    {
+        // Doing <- on a name already declared in the same block assigns to
+        // it. In a nested block, it declares a new variable.
+        if (mDepth == 0)
+        {
+            if (mDeclared.IndexOf(expr.Name()) != -1)
+            {
+                AddReassigned(expr.Name());
+            }
+            else
+            {
+                mDeclared.Add(expr.Name());
+            }
+        }
+
+        expr.Value()->Accept(*this, dest);
+    }
+
+    void AssignmentFinder::VisitDefinitions(const DefineExpr & expr)
+    {
+        // Method bodies are blocks, so they'll be treated as nested.
+        for (int i = 0; i < expr.Definitions().Count(); i++)
+        {
+            expr.Definitions()[i].GetBody()->Accept(*this, 0);
+        }
+    }
+
+    void AssignmentFinder::AddReassigned(const String & name)
+    {
+        if (mReassigned.IndexOf(name) == -1) mReassigned.Add(name);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Array.h"
+#include "IExprCompiler.h"
+#include "Macros.h"
+#include "FinchString.h"
+
+namespace Finch
+{
+    class DefineExpr;
+    class Expr;
+
+    // Walks the body of a block to find out which of its local variables
+    // may be assigned again after they're first initialized. The compiler
+    // copies variables that can't change straight into the blocks that
+    // capture them instead of sharing them through an Upvalue.
+    class AssignmentFinder : private IExprCompiler
+    {
+    public:
+        // Adds the names of the locals declared directly in the block with
+        // the given params and body that are ever reassigned to outNames.
+        // This is conservative: any "<--" to a name anywhere in the body,
+        // including in nested blocks that may declare their own variable
+        // with that name, counts.
+        static void Find(const Array<String> & params, const Expr & body,
+                         Array<String> & outNames);
+
+    private:
+        AssignmentFinder(const Array<String> & params, Array<String> & names);
+
+        virtual ~AssignmentFinder() {}
+
+        virtual void Visit(const ArrayExpr & expr, int dest);
+        virtual void Visit(const BindExpr & expr, int dest);
+        virtual void Visit(const BlockExpr & expr, int dest);
+        virtual void Visit(const MessageExpr & expr, int dest);
+        virtual void Visit(const NameExpr & expr, int dest);
+        virtual void Visit(const NumberExpr & expr, int dest);
+        virtual void Visit(const ObjectExpr & expr, int dest);
+        virtual void Visit(const ReturnExpr & expr, int dest);
+        virtual void Visit(const SequenceExpr & expr, int dest);
+        virtual void Visit(const SelfExpr & expr, int dest);
+        virtual void Visit(const SetExpr & expr, int dest);
+        virtual void Visit(const StringExpr & expr, int dest);
+        virtual void Visit(const UndefineExpr & expr, int dest);
+        virtual void Visit(const VarExpr & expr, int dest);
+
+        void VisitDefinitions(const DefineExpr & expr);
+        void AddReassigned(const String & name);
+
+        // How many blocks deep inside the one being scanned we are.
+        int mDepth;
+
+        // Names declared directly in the block being scanned so far.
+        Array<String> mDeclared;
+
+        Array<String> & mReassigned;
+
+        NO_COPY(AssignmentFinder);
+    };
+}
@@ -1,4 +1,5 @@
 #include "Block.h"
+#include "Heap.h"
 
 #ifdef DEBUG
 #include "Environment.h"
@@ -11,9 +12,19 @@ namespace Finch
         mParams(params),
         mCode(),
         mConstants(),
-        mNumRegisters(0)
+        mNumRegisters(0),
+        mNumUpvalues(0),
+        mNumCaptures(0),
+        mHasNonLocalReturn(false),
+        mHeap(NULL),
+        mHeapSize(0)
     {
     }
+    
+    Block::~Block()
+    {
+        if (mHeap != NULL) mHeap->RemoveBlock(mHeapSize);
+    }
 
     int Block::AddConstant(const Value & object)
     {
@@ -28,6 +39,54 @@ namespace Finch
         return mBlocks.Count() - 1;
     }
     
+    int Block::AddTemplate(Ref<ObjectTemplate> objectTemplate)
+    {
+        mTemplates.Add(objectTemplate);
+        return mTemplates.Count() - 1;
+    }
+    
+    int Block::GetSize() const
+    {
+        return static_cast<int>(sizeof(Block)) +
+               mParams.Capacity() * static_cast<int>(sizeof(String)) +
+               mCode.Capacity() * static_cast<int>(sizeof(Instruction)) +
+               mConstants.Capacity() * static_cast<int>(sizeof(Value)) +
+               mBlocks.Capacity() * static_cast<int>(sizeof(Ref<Block>)) +
+               mTemplates.Capacity() *
+                   static_cast<int>(sizeof(Ref<ObjectTemplate>));
+    }
+    
+    void Block::VisitConstants(IReferenceVisitor & visitor) const
+    {
+        for (int i = 0; i < mConstants.Count(); i++)
+        {
+            visitor.Visit(mConstants[i]);
+        }
+        
+        for (int i = 0; i < mTemplates.Count(); i++)
+        {
+            typedef IdTable<DynamicObject::Method>::Iterator Iterator;
+            for (Iterator it(mTemplates[i]->Methods()); !it.IsDone(); it.Next())
+            {
+                visitor.Visit(it.Value().block);
+            }
+        }
+        
+        for (int i = 0; i < mBlocks.Count(); i++)
+        {
+            mBlocks[i]->VisitConstants(visitor);
+        }
+    }
+    
+    void Block::SetHeap(Heap & heap)
+    {
+        ASSERT(mHeap == NULL, "Block is already counted in a heap.");
+        
+        mHeap = &heap;
+        mHeapSize = GetSize();
+        heap.AddBlock(mHeapSize);
+    }
+    
     // Writes an instruction.
     void Block::Write(OpCode op, int a, int b, int c)
     {
@@ -82,6 +141,9 @@ namespace Finch
             case OP_OBJECT:
                 cout << "OBJECT       " << a;
                 break;
+            case OP_OBJECT_TEMPLATE:
+                cout << "OBJECT_TMPL  " << a << " (template " << b << ")";
+                break;
             case OP_ARRAY:
                 cout << "ARRAY        [" << a << "] -> " << b;
                 break;
@@ -113,6 +175,9 @@ namespace Finch
             case OP_SET_UPVALUE:
                 cout << "SET_UPVALUE  " << a << " -> " << b;
                 break;
+            case OP_GET_CAPTURE:
+                cout << "GET_CAPTURE  " << a << " -> " << b;
+                break;
             case OP_GET_FIELD:
                 cout << "GET_FIELD    '" << environment.Strings().Find(a) << "' -> " << b;
                 break;
@@ -137,12 +202,24 @@ namespace Finch
             case OP_RETURN:
                 cout << "RETURN       m" << a << " ^ " << b;
                 break;
+            case OP_FOR_PREP:
+                cout << "FOR_PREP     " << a << " (" << b << ") -> " << c;
+                break;
+            case OP_FOR_LOOP:
+                cout << "FOR_LOOP     " << a << " (" << b << ") -> " << c;
+                break;
             case OP_CAPTURE_LOCAL:   // A = register of local
                 cout << "CAP_LOCAL    " << a;
                 break;
             case OP_CAPTURE_UPVALUE:
                 cout << "CAP_UPVALUE  " << a;
                 break;
+            case OP_COPY_LOCAL:
+                cout << "COPY_LOCAL   " << a;
+                break;
+            case OP_COPY_CAPTURE:
+                cout << "COPY_CAPTURE " << a;
+                break;
             default:
                 cout << "UNKNOWN OP " << op;
         }
@@ -6,6 +6,7 @@
 #include "FinchString.h"
 #include "Macros.h"
 #include "Object.h"
+#include "ObjectTemplate.h"
 #include "Ref.h"
 
 #define DECODE_OP(inst) (static_cast<OpCode>((inst & 0xff000000) >> 24))
@@ -15,6 +16,8 @@
 
 namespace Finch
 {
+    class Heap;
+    
     // TODO(bob): We expect this to be 32 bits. Is there a better way to specify
     // this?
     typedef unsigned int Instruction;
@@ -24,6 +27,8 @@ namespace Finch
         OP_CONSTANT,        // A = index of constant, B = dest register
         OP_BLOCK,           // A = index of example, B = dest register
         OP_OBJECT,          // A = parent register and dest register
+        OP_OBJECT_TEMPLATE, // A = parent register and dest register,
+                            // B = index of object template
         OP_ARRAY,           // A = initial capacity, B = dest register
         OP_ARRAY_ELEMENT,   // A = element register, B = dest array register
         OP_MOVE,            // A = source register, B = dest register
@@ -52,6 +57,7 @@ namespace Finch
         OP_TAIL_MESSAGE_10,
         OP_GET_UPVALUE,   // A = index of upvalue, B = dest reg
         OP_SET_UPVALUE,   // A = index of upvalue, B = value reg
+        OP_GET_CAPTURE,   // A = index of copied value, B = dest reg
         OP_GET_FIELD,     // A = index of field in string table, B = dest reg
         OP_SET_FIELD,     // A = index of field in string table, B = value reg
         OP_GET_GLOBAL,    // A = index of global, B = dest reg
@@ -65,12 +71,18 @@ namespace Finch
         OP_END,           // A = register with result to return
         OP_RETURN,        // A = method id to return from,
                           // B = register with value to return
+        OP_FOR_PREP,      // A = register of receiver (args follow),
+                          // B = number of args, C = dest register
+        OP_FOR_LOOP,      // A = register of receiver (args follow),
+                          // B = number of args, C = dest register
         
         // TODO(bob): These are pseudo-ops that only appear following an
         // OP_BLOCK instruction. If we want to minimize the number of ops, we
         // could reuse existing opcodes for these.
         OP_CAPTURE_LOCAL,   // A = register of local
-        OP_CAPTURE_UPVALUE  // A = index of upvalue
+        OP_CAPTURE_UPVALUE, // A = index of upvalue
+        OP_COPY_LOCAL,      // A = register of local
+        OP_COPY_CAPTURE     // A = index of copied value
     };
         
     // A compiled block. This contains the state that all blocks created from
@@ -85,6 +97,8 @@ namespace Finch
         // Creates a new Block with the given parameters.
         Block(int methodId, const Array<String> & params);
         
+        ~Block();
+        
         int MethodId() const { return mMethodId; }
         
         // Gets the names of the parameters that this block expects.
@@ -96,6 +110,17 @@ namespace Finch
         int  NumUpvalues() const { return mNumUpvalues; }
         void SetNumUpvalues(int numUpvalues) { mNumUpvalues = numUpvalues; }
         
+        // Gets the number of captured variables that are copied into the
+        // block object by value because they never change.
+        int  NumCaptures() const { return mNumCaptures; }
+        void SetNumCaptures(int numCaptures) { mNumCaptures = numCaptures; }
+        
+        // Gets whether this block, or a block nested in it, returns from the
+        // method it's in. Blocks created from it need to know the call frame
+        // of that method.
+        bool HasNonLocalReturn() const { return mHasNonLocalReturn; }
+        void SetHasNonLocalReturn(bool value) { mHasNonLocalReturn = value; }
+        
         // Adds the given object to the constant pool and returns its index.
         int AddConstant(const Value & object);
         
@@ -108,6 +133,16 @@ namespace Finch
         // Gets the child block at the given index in the pool.
         const Ref<Block> GetBlock(int index) const { return mBlocks[index]; }
         
+        // Adds the given object literal template to the pool and returns its
+        // index.
+        int AddTemplate(Ref<ObjectTemplate> objectTemplate);
+        
+        // Gets the object literal template at the given index in the pool.
+        const ObjectTemplate & GetTemplate(int index) const
+        {
+            return *mTemplates[index];
+        }
+        
         // Gets the bytecode for this block.
         const Array<Instruction> & Code() const { return mCode; }
         
@@ -117,6 +152,18 @@ namespace Finch
         // If the last instruction is a MESSAGE, translates it to a tail call.
         void MarkTailCall();
         
+        // Gets roughly how many bytes this block uses. Its constants and
+        // nested blocks aren't included, since they're counted on their own.
+        int GetSize() const;
+        
+        // Passes the constants in this block and the blocks nested in it to
+        // the visitor, along with the methods of their object templates.
+        void VisitConstants(IReferenceVisitor & visitor) const;
+        
+        // Counts this block in the given heap until it's destroyed. Called
+        // once it's done being compiled.
+        void SetHeap(Heap & heap);
+        
 #ifdef DEBUG
         void DumpInstruction(Environment & environment, const String & prefix, Instruction instruction);
         void DebugDump(Environment & environment, const String & prefix);
@@ -129,8 +176,16 @@ namespace Finch
         Array<Value>        mConstants;
         // Blocks contained within this one.
         Array<Ref<Block> >  mBlocks;
+        Array<Ref<ObjectTemplate> > mTemplates;
         int                 mNumRegisters;
         int                 mNumUpvalues;
+        int                 mNumCaptures;
+        bool                mHasNonLocalReturn;
+        
+        // The heap this block is counted in and the size it was counted as,
+        // or NULL if it isn't.
+        Heap *              mHeap;
+        int                 mHeapSize;
     };
 }
 
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "ArrayExpr.h"
+#include "AssignmentFinder.h"
 #include "BindExpr.h"
 #include "BlockExpr.h"
 #include "Compiler.h"
@@ -41,14 +42,24 @@ namespace Finch
         mBlock(),
         mInUseRegisters(0),
         mLocals(),
+        mUpvalues(),
+        mParams(NULL),
+        mBody(NULL),
+        mFoundReassigned(false),
+        mReassigned(),
+        mInitializingLocals(),
         mObjectLiterals(),
-        mHasReturn(false)
+        mHasReturn(false),
+        mHasNonLocalReturn(false),
+        mUsesSelf(false)
     {}
 
     void Compiler::Compile(int methodId, const Array<String> & params,
                            const Expr & expr)
     {
         mBlock = Ref<Block>(new Block(methodId, params));
+        mParams = &params;
+        mBody = &expr;
         
         // Reserve registers for the params. These have to go first because the
         // caller will place them here.
@@ -84,7 +95,18 @@ namespace Finch
         // Now that all upvalues for this block are known (and its contained
         // blocks have also been compiled, which due to closure flattening may
         // upvalues to this block), we can store the number of upvalues.
-        mBlock->SetNumUpvalues(mUpvalues.Count());
+        int numCaptures = 0;
+        for (int i = 0; i < mUpvalues.Count(); i++)
+        {
+            if (mUpvalues[i].IsFixed()) numCaptures++;
+        }
+        
+        mBlock->SetNumUpvalues(mUpvalues.Count() - numCaptures);
+        mBlock->SetNumCaptures(numCaptures);
+        mBlock->SetHasNonLocalReturn(mHasNonLocalReturn);
+        
+        // It won't change any more, so start counting it.
+        mBlock->SetHeap(mInterpreter.GetHeap());
     }
     
     void Compiler::Visit(const ArrayExpr & expr, int dest)
@@ -139,6 +161,12 @@ namespace Finch
                 message.GetArguments()[arg]->Accept(*this, argReg);
             }
             
+            if (IsCountedLoop(*expr.Receiver(), message))
+            {
+                CompileCountedLoop(receiverReg, message.GetArguments().Count(),
+                                   dest);
+            }
+            
             // Compile the message send.
             // TODO(bob): Right now, we're only giving 8-bits to the name, which
             // will run out quickly.
@@ -172,6 +200,7 @@ namespace Finch
             // Accessing a field.
             StringId index = mInterpreter.AddString(expr.Name());
             mBlock->Write(OP_GET_FIELD, index, dest);
+            mUsesSelf = true;
         }
         else
         {
@@ -187,6 +216,11 @@ namespace Finch
                 // Copy the local to the destination register.
                 mBlock->Write(OP_MOVE, index, dest);
             }
+            else if (resolvedUpvalue.IsValid() && resolvedUpvalue.IsFixed())
+            {
+                // Load the copied value into the destination register.
+                mBlock->Write(OP_GET_CAPTURE, resolvedUpvalue.Slot(), dest);
+            }
             else if (resolvedUpvalue.IsValid())
             {
                 // Load the upvalue into the destination register.
@@ -215,11 +249,22 @@ namespace Finch
         // Compile the parent. It will go into the same register that we'll
         // put the new object into.
         expr.Parent()->Accept(*this, dest);
-        mBlock->Write(OP_OBJECT, dest);
+        
+        // An empty literal doesn't need a template.
+        if (expr.Definitions().Count() == 0)
+        {
+            mBlock->Write(OP_OBJECT, dest);
+            return;
+        }
+        
+        // The template is filled in as the definitions are compiled.
+        Ref<ObjectTemplate> objectTemplate(new ObjectTemplate());
+        int index = mBlock->AddTemplate(objectTemplate);
+        mBlock->Write(OP_OBJECT_TEMPLATE, dest, index);
         
         // Keep track of the fact that we're inside an object literal.
         mObjectLiterals.Push(dest);
-        CompileDefinitions(expr, dest);
+        CompileDefinitions(expr, dest, &*objectTemplate);
         mObjectLiterals.Pop();
     }
     
@@ -239,6 +284,14 @@ namespace Finch
         
         // Disable tail calls for the method.
         method->mHasReturn = true;
+        
+        // Every block between here and the method needs to know which call
+        // of the method it was created in.
+        for (Compiler * compiler = this; compiler != method;
+             compiler = compiler->mParent)
+        {
+            compiler->mHasNonLocalReturn = true;
+        }
     }
     
     void Compiler::Visit(const SelfExpr & expr, int dest)
@@ -254,6 +307,7 @@ namespace Finch
         {
             // Do a normal dynamic lookup on `self`.
             mBlock->Write(OP_SELF, dest);
+            mUsesSelf = true;
         }
     }
     
@@ -296,6 +350,11 @@ namespace Finch
             }
             else if (resolvedUpvalue.IsValid())
             {
+                // Anything assigned with <-- is reassigned, so it can't
+                // have been copied.
+                ASSERT(!resolvedUpvalue.IsFixed(),
+                       "Cannot assign to a copied upvalue.");
+                
                 // Evaluate the value.
                 expr.Value()->Accept(*this, dest);
                 
@@ -354,7 +413,8 @@ namespace Finch
         {
             // Doing <- on an existing name just assigns.
             int local = mLocals.IndexOf(expr.Name());
-            if (local == -1) {
+            bool isNew = (local == -1);
+            if (isNew) {
                 // Create a new local.
                 local = ReserveRegister();
                 mLocals.Add(expr.Name());
@@ -363,11 +423,15 @@ namespace Finch
                 // at register 0. NameExpr assumes that.
                 ASSERT(local == mLocals.Count() - 1,
                     "Local should be in right register.");
+                
+                mInitializingLocals.Push(local);
             }
             
             // Evaluate the value and store in the local.
             expr.Value()->Accept(*this, local);
             
+            if (isNew) mInitializingLocals.Pop();
+            
             // Also copy to the destination register.
             // Handles cases like: foo: bar <- baz
             mBlock->Write(OP_MOVE, local, dest);
@@ -402,7 +466,9 @@ namespace Finch
                 *outIndex = local;
             }
             
-            *outUpvalue = Upvalue(true, local);
+            // Only look at how it's assigned if it's really being captured.
+            *outUpvalue = Upvalue(true, local,
+                (compiler != this) && compiler->IsFixedLocal(local));
             return;
         }
         
@@ -423,8 +489,7 @@ namespace Finch
         // to a variable defined outside of our immediately enclosing block,
         // each intervening block will copy that variable into its upvalues so
         // we can walk it down to the block that uses it.
-        upvalue.SetSlot(compiler->mUpvalues.Count());
-        compiler->mUpvalues.Add(upvalue);
+        upvalue.SetSlot(compiler->AddUpvalue(upvalue));
         
         if (compiler == this)
         {
@@ -433,7 +498,39 @@ namespace Finch
             *outResolvedUpvalue = upvalue;
         }
         
-        *outUpvalue = Upvalue(false, upvalue.Slot());
+        *outUpvalue = Upvalue(false, upvalue.Slot(), upvalue.IsFixed());
+    }
+    
+    int Compiler::AddUpvalue(Upvalue upvalue)
+    {
+        // Fixed and unfixed upvalues are stored separately in the block
+        // object, so each kind gets its own slots.
+        int slot = 0;
+        for (int i = 0; i < mUpvalues.Count(); i++)
+        {
+            if (mUpvalues[i].IsSame(upvalue)) return mUpvalues[i].Slot();
+            if (mUpvalues[i].IsFixed() == upvalue.IsFixed()) slot++;
+        }
+        
+        upvalue.SetSlot(slot);
+        mUpvalues.Add(upvalue);
+        return slot;
+    }
+    
+    bool Compiler::IsFixedLocal(int local)
+    {
+        for (int i = 0; i < mInitializingLocals.Count(); i++)
+        {
+            if (mInitializingLocals[i] == local) return false;
+        }
+        
+        if (!mFoundReassigned)
+        {
+            AssignmentFinder::Find(*mParams, *mBody, mReassigned);
+            mFoundReassigned = true;
+        }
+        
+        return mReassigned.IndexOf(mLocals[local]) == -1;
     }
     
     void Compiler::CompileSetGlobal(const String & name, const Expr & value, int dest)
@@ -452,12 +549,32 @@ namespace Finch
         
         StringId nameId = mInterpreter.AddString(name);
         mBlock->Write(OP_SET_FIELD, nameId, dest);
+        mUsesSelf = true;
     }
 
     void Compiler::CompileNestedBlock(int methodId, const BlockExpr & block, int dest)
     {
         Compiler compiler(mInterpreter, this);
         compiler.Compile(methodId, block.Params(), *block.Body());
+        WriteNestedBlock(compiler, dest);
+    }
+    
+    void Compiler::WriteNestedBlock(const Compiler & compiler, int dest)
+    {
+        // A block that captures nothing and never looks at self is the same
+        // every time it's evaluated, so create it once now and load it as a
+        // constant. One that returns from its method can't be shared since
+        // it has to know which call of the method made it.
+        if ((compiler.mUpvalues.Count() == 0) && !compiler.mUsesSelf &&
+            !compiler.mHasNonLocalReturn)
+        {
+            CompileConstant(mInterpreter.NewBlock(compiler.mBlock,
+                                                  mInterpreter.Nil()), dest);
+            return;
+        }
+        
+        // Otherwise, the new block gets this one's self.
+        mUsesSelf = true;
         
         int index = mBlock->AddBlock(compiler.mBlock);
         
@@ -466,8 +583,18 @@ namespace Finch
         // Capture the upvalues.
         for (int i = 0; i < compiler.mUpvalues.Count(); i++)
         {
-            Upvalue & upvalue = compiler.mUpvalues[i];
-            if (upvalue.IsLocal())
+            const Upvalue & upvalue = compiler.mUpvalues[i];
+            if (upvalue.IsFixed() && upvalue.IsLocal())
+            {
+                // Copying a local.
+                mBlock->Write(OP_COPY_LOCAL, upvalue.Index());
+            }
+            else if (upvalue.IsFixed())
+            {
+                // Copying a value this block copied.
+                mBlock->Write(OP_COPY_CAPTURE, upvalue.Index());
+            }
+            else if (upvalue.IsLocal())
             {
                 // Closing over a local.
                 mBlock->Write(OP_CAPTURE_LOCAL, upvalue.Index());
@@ -488,7 +615,51 @@ namespace Finch
         mBlock->Write(OP_CONSTANT, index, dest);
     }
     
-    void Compiler::CompileDefinitions(const DefineExpr & expr, int dest)
+    bool Compiler::IsCountedLoop(const Expr & receiver,
+                                 const MessageSend & message)
+    {
+        // Only a literal block can be called without sending it call:.
+        const Array<Ref<Expr> > & args = message.GetArguments();
+        if (args.Count() == 0) return false;
+        if (args[args.Count() - 1]->AsBlock() == NULL) return false;
+        
+        const NameExpr * name = receiver.AsName();
+        if ((name == NULL) || (name->Name() != "Ether")) return false;
+        
+        return (message.GetName() == "from:to:do:") ||
+               (message.GetName() == "from:to:step:do:");
+    }
+    
+    void Compiler::CompileCountedLoop(int receiverReg, int numArgs, int dest)
+    {
+        // A counted loop is compiled to:
+        //
+        //     FOR_PREP
+        //     FOR_LOOP
+        //     MESSAGE   from:to:do:
+        //
+        // If the receiver is Ether and it still has its primitive loop,
+        // FOR_PREP starts the loop and calls the block directly. Each time the
+        // block returns, FOR_LOOP steps the index and calls it again until it
+        // passes the end, then skips the message. Otherwise, FOR_PREP skips
+        // FOR_LOOP and the message is sent normally.
+        //
+        // The loop keeps its index and step in the registers after the
+        // arguments, and passes the index to the block in the one after that.
+        ReserveRegister();
+        ReserveRegister();
+        ReserveRegister();
+        
+        mBlock->Write(OP_FOR_PREP, receiverReg, numArgs, dest);
+        mBlock->Write(OP_FOR_LOOP, receiverReg, numArgs, dest);
+        
+        ReleaseRegister();
+        ReleaseRegister();
+        ReleaseRegister();
+    }
+    
+    void Compiler::CompileDefinitions(const DefineExpr & expr, int dest,
+                                      ObjectTemplate * objectTemplate)
     {
         // Compile each of the definitions.
         int count = expr.Definitions().Count();
@@ -503,14 +674,36 @@ namespace Finch
                 BlockExpr & body = static_cast<BlockExpr &>(
                     *definition.GetBody());
                 
-                CompileNestedBlock(sNextMethodId++, body, value);
+                Compiler compiler(mInterpreter, this);
+                compiler.Compile(sNextMethodId++, body.Params(), *body.Body());
                 
-                // TODO(bob): Right now, we're only giving 8-bits to the name,
-                // which will run out quickly.
-                mBlock->Write(OP_DEF_METHOD, name, value, dest);
+                // A method that doesn't close over anything is the same for
+                // every object the literal creates, so it can be created now
+                // and shared. The template binds its methods before any of
+                // the definitions run, so a method that shares its name with
+                // another one in the literal has to be left out of it to keep
+                // the last one winning.
+                if ((objectTemplate != NULL) &&
+                    (compiler.mUpvalues.Count() == 0) &&
+                    IsOnlyMethodNamed(expr, i))
+                {
+                    objectTemplate->AddMethod(name,
+                        mInterpreter.NewBlock(compiler.mBlock,
+                                              mInterpreter.Nil()));
+                }
+                else
+                {
+                    WriteNestedBlock(compiler, value);
+                    
+                    // TODO(bob): Right now, we're only giving 8-bits to the
+                    // name, which will run out quickly.
+                    mBlock->Write(OP_DEF_METHOD, name, value, dest);
+                }
             }
             else
             {
+                if (objectTemplate != NULL) objectTemplate->AddField();
+                
                 // Compile the initializer.
                 definition.GetBody()->Accept(*this, value);
                 mBlock->Write(OP_DEF_FIELD, name, value, dest);
@@ -520,6 +713,21 @@ namespace Finch
         }
     }
     
+    bool Compiler::IsOnlyMethodNamed(const DefineExpr & expr, int index)
+    {
+        const Array<Definition> & definitions = expr.Definitions();
+        for (int i = 0; i < definitions.Count(); i++)
+        {
+            if ((i != index) && definitions[i].IsMethod() &&
+                (definitions[i].GetName() == definitions[index].GetName()))
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
     Compiler * Compiler::GetEnclosingMethod()
     {
         Compiler * compiler = this;
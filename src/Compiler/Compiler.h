@@ -14,6 +14,7 @@
 namespace Finch
 {
     class DefineExpr;
+    class MessageSend;
     
     class Compiler : private IExprCompiler
     {
@@ -30,24 +31,43 @@ namespace Finch
             Upvalue()
             :   mIsLocal(false),
             mIndex(-1),
+            mIsFixed(false),
             mSlot(-1)
             {}
             
-            Upvalue(bool isLocal, int index)
+            Upvalue(bool isLocal, int index, bool isFixed)
             :   mIsLocal(isLocal),
             mIndex(index),
+            mIsFixed(isFixed),
             mSlot(-1)
             {}
             
             bool IsValid() const { return mIndex != -1; }
             bool IsLocal() const { return mIsLocal; }
             int Index() const { return mIndex; }
+            
+            // Gets whether the variable is never assigned after it's been
+            // captured, in which case the block gets a copy of its value
+            // instead of an Upvalue.
+            bool IsFixed() const { return mIsFixed; }
+            
+            // Gets whether this refers to the same variable as other.
+            bool IsSame(const Upvalue & other) const
+            {
+                return (mIsLocal == other.mIsLocal) &&
+                       (mIndex == other.mIndex) &&
+                       (mIsFixed == other.mIsFixed);
+            }
+            
+            // The index of the upvalue, or of the copied value, in the
+            // block. Fixed and unfixed upvalues are numbered separately.
             void SetSlot(int slot) { mSlot = slot; }
             int Slot() const { return mSlot; }
             
         private:
             bool mIsLocal;
             int  mIndex;
+            bool mIsFixed;
             int  mSlot;
         };
         
@@ -80,11 +100,37 @@ namespace Finch
         void ResolveName(Compiler * compiler, const String & name,
             Upvalue * outUpvalue, bool * outIsLocal, int * outIndex,
             Upvalue * outResolvedUpvalue);
+        // Adds the upvalue to this block if it isn't already captured and
+        // returns its slot.
+        int AddUpvalue(Upvalue upvalue);
+        
+        // Gets whether the local in the given register can be copied into
+        // the blocks that capture it because it won't change afterwards.
+        bool IsFixedLocal(int local);
+        
         void CompileSetGlobal(const String & name, const Expr & value, int dest);
         void CompileSetField(const String & name, const Expr & value, int dest);
         void CompileNestedBlock(int methodId, const BlockExpr & block, int dest);
         void CompileConstant(const Value & constant, int dest);
-        void CompileDefinitions(const DefineExpr & expr, int dest);
+        
+        // Adds a block compiled by a child compiler to this one, and writes
+        // the code to create it (and capture its upvalues) into dest.
+        void WriteNestedBlock(const Compiler & compiler, int dest);
+        
+        // Compiles the definitions in an object literal or a "::" expression.
+        // For a literal, objectTemplate is its template, which gets the
+        // literal's field names and any methods that can be shared.
+        void CompileDefinitions(const DefineExpr & expr, int dest,
+                                ObjectTemplate * objectTemplate = NULL);
+        
+        // Gets whether the method definition at index is the only one in
+        // expr with its name.
+        bool IsOnlyMethodNamed(const DefineExpr & expr, int index);
+        
+        // Gets whether the message is a from:to:do: or from:to:step:do: sent
+        // to Ether with a literal block that can be compiled to a native loop.
+        bool IsCountedLoop(const Expr & receiver, const MessageSend & message);
+        void CompileCountedLoop(int receiverReg, int numArgs, int dest);
 
         Compiler * GetEnclosingMethod();
 
@@ -104,6 +150,19 @@ namespace Finch
         Array<String> mLocals;
         Array<Upvalue> mUpvalues;
         
+        // The params and body of the block being compiled, and the names of
+        // its locals that are ever reassigned. Those are only found once a
+        // nested block captures one of the locals.
+        const Array<String> * mParams;
+        const Expr * mBody;
+        bool mFoundReassigned;
+        Array<String> mReassigned;
+        
+        // Locals whose initializers are being compiled. A block created in
+        // its own variable's initializer has to see the value assigned after
+        // it, so it can't just copy it.
+        Stack<int> mInitializingLocals;
+        
         // Registers containing the currently enclosing object literals. Within
         // an object literal a reference to 'self' inside a field initializer
         // will refer to the enclosing object and not the current dynamically
@@ -115,6 +174,15 @@ namespace Finch
         // that have a non-local return since the return needs to be able to
         // find the method on the stack when unwinding.
         bool mHasReturn;
+        
+        // `true` if this is a block (not a method) that contains a `return`
+        // from its enclosing method, or contains a block that does.
+        bool mHasNonLocalReturn;
+        
+        // `true` if this block reads `self` or a field, or creates a block
+        // that needs `self`. Blocks that don't and have no upvalues are
+        // compiled to constants.
+        bool mUsesSelf;
 
         NO_COPY(Compiler);
     };
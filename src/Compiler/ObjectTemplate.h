@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Dictionary.h"
+#include "DynamicObject.h"
+#include "Macros.h"
+#include "Object.h"
+
+namespace Finch
+{
+    // The parts of an object literal that are the same every time it is
+    // evaluated: how many fields it has, and the methods that don't close
+    // over any local variables. Objects created from the literal start with
+    // room for their fields and a copy of the template's methods, so only
+    // the field values and any methods that do capture something need to
+    // be filled in afterwards.
+    class ObjectTemplate
+    {
+    public:
+        ObjectTemplate()
+        :   mNumFields(0)
+        {}
+        
+        // The number of fields the literal defines.
+        int NumFields() const { return mNumFields; }
+        
+        const IdTable<DynamicObject::Method> & Methods() const
+        {
+            return mMethods;
+        }
+        
+        void AddField() { mNumFields++; }
+        
+        // Binds a method to the template. Since the block doesn't capture
+        // anything, every object created from the template can share it.
+        void AddMethod(StringId name, const Value & block)
+        {
+            DynamicObject::Method method;
+            method.block = block;
+            mMethods.Insert(name, method);
+        }
+        
+    private:
+        int                             mNumFields;
+        IdTable<DynamicObject::Method>  mMethods;
+        
+        NO_COPY(ObjectTemplate);
+    };
+}
+
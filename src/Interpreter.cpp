@@ -6,18 +6,24 @@
 #include "BlockPrimitives.h"
 #include "Compiler.h"
 #include "DynamicObject.h"
+#include "EtherPrimitives.h"
 #include "Expr.h"
 #include "Fiber.h"
 #include "FiberObject.h"
 #include "FiberPrimitives.h"
 #include "FileLineReader.h"
 #include "FinchParser.h"
+#include "HeapDump.h"
 #include "IErrorReporter.h"
 #include "IInterpreterHost.h"
 #include "Interpreter.h"
 #include "IoPrimitives.h"
 #include "Lexer.h"
 #include "LineNormalizer.h"
+#include "MapObject.h"
+#include "MapPrimitives.h"
+#include "NumberArrayObject.h"
+#include "NumberArrayPrimitives.h"
 #include "NumberObject.h"
 #include "NumberPrimitives.h"
 #include "ObjectPrimitives.h"
@@ -46,7 +52,8 @@ namespace Finch
     };
     
     Interpreter::Interpreter(IInterpreterHost & host)
-    :   mHost(host)
+    :   mHost(host),
+        mHeap()
     {
         // Build the global scope.
         
@@ -63,6 +70,14 @@ namespace Finch
         AddPrimitive(mArrayPrototype, "at:",         ArrayAt);
         AddPrimitive(mArrayPrototype, "at:put:",     ArrayAtPut);
         AddPrimitive(mArrayPrototype, "remove-at:",  ArrayRemoveAt);
+        AddPrimitive(mArrayPrototype, "++",          ArrayConcat);
+        AddPrimitive(mArrayPrototype, "each:",       ArrayEach);
+        AddPrimitive(mArrayPrototype, "each:between:", ArrayEachBetween);
+        AddPrimitive(mArrayPrototype, "map:",        ArrayMap);
+        AddPrimitive(mArrayPrototype, "select:",     ArraySelect);
+        AddPrimitive(mArrayPrototype, "reject:",     ArrayReject);
+        AddPrimitive(mArrayPrototype, "inject:into:", ArrayInjectInto);
+        AddPrimitive(mArrayPrototype, "detect:",     ArrayDetect);
         
         // Blocks.
         mBlockPrototype = MakeGlobal("Blocks");
@@ -109,6 +124,31 @@ namespace Finch
         AddPrimitive(mNumberPrototype, "<=",  NumberLessThanOrEqual);
         AddPrimitive(mNumberPrototype, ">=",  NumberGreaterThanOrEqual);
         
+        // Number arrays.
+        mNumberArrayPrototype = MakeGlobal("NumberArrays");
+        AddPrimitive(mNumberArrayPrototype, "count",    NumberArrayCount);
+        AddPrimitive(mNumberArrayPrototype, "at:",      NumberArrayAt);
+        AddPrimitive(mNumberArrayPrototype, "at:put:",  NumberArrayAtPut);
+        AddPrimitive(mNumberArrayPrototype, "sum",      NumberArraySum);
+        AddPrimitive(mNumberArrayPrototype, "min",      NumberArrayMin);
+        AddPrimitive(mNumberArrayPrototype, "max",      NumberArrayMax);
+        AddPrimitive(mNumberArrayPrototype, "dot:",     NumberArrayDot);
+        AddPrimitive(mNumberArrayPrototype, "+",        NumberArrayAdd);
+        AddPrimitive(mNumberArrayPrototype, "*",        NumberArrayMultiply);
+        AddPrimitive(mNumberArrayPrototype, "+number:", NumberArrayAdd);
+        AddPrimitive(mNumberArrayPrototype, "*number:", NumberArrayMultiply);
+        AddPrimitive(mNumberArrayPrototype, "scale:",   NumberArrayScale);
+        AddPrimitive(mNumberArrayPrototype, "sort",     NumberArraySort);
+        
+        // Map.
+        mMapPrototype = MakeGlobal("Maps");
+        AddPrimitive(mMapPrototype, "count",     MapCount);
+        AddPrimitive(mMapPrototype, "at:",       MapAt);
+        AddPrimitive(mMapPrototype, "at:put:",   MapAtPut);
+        AddPrimitive(mMapPrototype, "contains:", MapContains);
+        AddPrimitive(mMapPrototype, "remove:",   MapRemove);
+        AddPrimitive(mMapPrototype, "each:",     MapEach);
+        
         // Strings.
         mStringPrototype = MakeGlobal("Strings");
         AddPrimitive(mStringPrototype, "count",       StringCount);
@@ -116,9 +156,17 @@ namespace Finch
         AddPrimitive(mStringPrototype, "from:count:", StringFromCount);
         AddPrimitive(mStringPrototype, "hash-code",   StringHashCode);
         AddPrimitive(mStringPrototype, "index-of:",   StringIndexOf);
+        AddPrimitive(mStringPrototype, "last-index-of:", StringLastIndexOf);
+        
+        for (int i = 0; i < 256; i++)
+        {
+            mCharacters.Add(NewString(String(static_cast<char>(i))));
+        }
         
         // Ether.
-        MakeGlobal("Ether");
+        mEther = MakeGlobal("Ether");
+        AddPrimitive(mEther, "from:to:do:",      EtherFromToDo);
+        AddPrimitive(mEther, "from:to:step:do:", EtherFromToStepDo);
         
         // Io.
         Value io = MakeGlobal("Io");
@@ -129,12 +177,16 @@ namespace Finch
         AddPrimitive(primitives, "string-concat:and:",       PrimitiveStringConcat);
         AddPrimitive(primitives, "string-compare:to:",       PrimitiveStringCompare);
         AddPrimitive(primitives, "write:",                   PrimitiveWrite);
+        AddPrimitive(primitives, "number-array:",            PrimitiveNumberArray);
+        AddPrimitive(primitives, "new-map",                  PrimitiveNewMap);
+        AddPrimitive(primitives, "new-fiber:",               PrimitiveNewFiber);
         /*
-         AddPrimitive(primitives, "new-fiber:",               PrimitiveNewFiber);
          AddPrimitive(primitives, "current-fiber",            PrimitiveGetCurrentFiber);
          AddPrimitive(primitives, "switch-to-fiber:passing:", PrimitiveSwitchToFiber);
          */
         AddPrimitive(primitives, "callstack-depth",          PrimitiveGetCallstackDepth);
+        AddPrimitive(primitives, "collect",                  PrimitiveCollect);
+        AddPrimitive(primitives, "live-bytes",               PrimitiveLiveBytes);
         
         // The special singleton values.
         mNil = MakeGlobal("nil");
@@ -144,18 +196,38 @@ namespace Finch
     
     void Interpreter::Interpret(ILineReader & reader, bool showResult)
     {
-        Ref<Expr> expr = Parse(reader);
-        
-        // Bail if we failed to parse.
-        if (expr.IsNull()) return;
-        
-        // Create a starting fiber for the expression.
-        Ref<Block> block = Compiler::CompileTopLevel(*this, *expr);
-        Value blockObj = NewBlock(block, mNil);
-        Value fiber = NewFiber(blockObj);
+        InterpreterErrorReporter errorReporter(*this);
+        Lexer          lexer(reader);
+        LineNormalizer normalizer(lexer);
+        FinchParser    parser(normalizer, errorReporter);
         
-        // Run the interpreter.
-        Value result = fiber.AsFiber()->GetFiber().Execute();
+        Value result;
+        if (reader.IsInfinite())
+        {
+            Ref<Expr> expr = parser.Parse();
+            
+            // Bail if we failed to parse.
+            if (expr.IsNull()) return;
+            
+            result = Execute(*expr);
+        }
+        else
+        {
+            // Stream through the source one top-level expression at a time.
+            // Each expression's AST and compiled block are released once it
+            // has run, so memory use is bounded by the largest expression
+            // instead of the whole file, and output starts right away.
+            while (true)
+            {
+                Ref<Expr> expr = parser.ParseTopLevel();
+                if (expr.IsNull()) break;
+                
+                result = Execute(*expr);
+            }
+            
+            // Bail if we didn't run anything.
+            if (result.IsNull()) return;
+        }
         
         if (showResult)
         {
@@ -249,47 +321,78 @@ namespace Finch
     
     Value Interpreter::NewObject(const Value & parent, String name)
     {
-        return Value(new DynamicObject(parent, name));
+        return Value(mHeap.Add(new DynamicObject(parent, name)));
     }
     
     Value Interpreter::NewObject(const Value & parent)
     {
-        return NewObject(parent, "");
+        return Value(mHeap.Add(new DynamicObject(parent)));
+    }
+    
+    Value Interpreter::NewObject(const Value & parent,
+                                 const ObjectTemplate & objectTemplate)
+    {
+        return Value(mHeap.Add(new DynamicObject(parent, objectTemplate)));
     }
     
     Value Interpreter::NewNumber(double value)
     {
-        return Value(new NumberObject(mNumberPrototype, value));
+        return Value(mHeap.Add(new NumberObject(mNumberPrototype, value)));
+    }
+    
+    Value Interpreter::NewNumberArray(int count)
+    {
+        return Value(mHeap.Add(new NumberArrayObject(mNumberArrayPrototype,
+                                                     count)));
+    }
+    
+    Value Interpreter::NewMap()
+    {
+        return Value(mHeap.Add(new MapObject(mMapPrototype)));
     }
     
     Value Interpreter::NewString(String value)
     {
-        return Value(new StringObject(mStringPrototype, value));
+        return Value(mHeap.Add(new StringObject(mStringPrototype, value)));
     }
     
     Value Interpreter::NewArray(int capacity)
     {
-        return Value(new ArrayObject(mArrayPrototype, capacity));
+        return Value(mHeap.Add(new ArrayObject(mArrayPrototype, capacity)));
     }
     
     Value Interpreter::NewBlock(Ref<Block> block, const Value & self)
     {
-        return Value(new BlockObject(mBlockPrototype, block, self));
+        return Value(mHeap.Add(new BlockObject(mBlockPrototype, block, self)));
     }
     
     Value Interpreter::NewFiber(const Value & block)
     {
-        return Value(new FiberObject(mFiberPrototype, *this, block));
+        return Value(mHeap.Add(new FiberObject(mFiberPrototype, *this, block)));
     }
     
-    Ref<Expr> Interpreter::Parse(ILineReader & reader)
+    Value Interpreter::Execute(const Expr & expr)
     {
-        InterpreterErrorReporter errorReporter(*this);
-        Lexer          lexer(reader);
-        LineNormalizer normalizer(lexer);
-        FinchParser    parser(normalizer, errorReporter);
+        // Create a starting fiber for the expression.
+        Ref<Block> block = Compiler::CompileTopLevel(*this, expr);
+        Value blockObj = NewBlock(block, mNil);
+        Value fiber = NewFiber(blockObj);
         
-        return parser.Parse();
+        // Run the interpreter. Objects it creates are tagged with where the
+        // fiber was when they were created. A script can load another one
+        // and run it in a fiber of its own, so the outer one is put back
+        // after.
+        Fiber & running = fiber.AsFiber()->GetFiber();
+        Fiber * caller = mHeap.SetRunningFiber(&running);
+        Value result = running.Execute();
+        mHeap.SetRunningFiber(caller);
+        
+        return result;
+    }
+    
+    void Interpreter::DumpHeap(ostream & out)
+    {
+        HeapDump::Write(*this, out);
     }
     
     Value Interpreter::MakeGlobal(const char * name)
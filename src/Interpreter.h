@@ -1,17 +1,23 @@
 #pragma once
 
+#include <iostream>
+
 #include "Dictionary.h"
+#include "Heap.h"
 #include "Macros.h"
 #include "Object.h"
 #include "StringTable.h"
 
 namespace Finch
 {
+    using std::ostream;
+    
     class IInterpreterHost;
     class ILineReader;
     //### bob: ideally, this stuff wouldn't be in the public api for Interpreter.
     class Object;
     class Fiber;
+    class ObjectTemplate;
     
     // The main top-level class for a Finch virtual machine. To host a Finch
     // interpreter from within your application, you will instantiate one of
@@ -22,11 +28,23 @@ namespace Finch
         Interpreter(IInterpreterHost & host);
         
         // Reads from the given source and executes the results in a new fiber
-        // in this interpreter.
+        // in this interpreter. Interactive sources are parsed a complete
+        // expression at a time. Other sources are streamed: each top-level
+        // expression is parsed, compiled and executed before the next one is
+        // read.
         void Interpret(ILineReader & reader, bool showResult);
         
         //### bob: exposing the entire host here is a bit dirty.
         IInterpreterHost & GetHost() { return mHost; }
+        
+        // Gets the heap that keeps count of the memory this interpreter is
+        // using. Set its limits to keep scripts from using too much.
+        Heap & GetHeap() { return mHeap; }
+        
+        // Writes every object reachable from the globals to the given stream
+        // as JSON, along with how much memory each global keeps alive. See
+        // HeapDump for the format.
+        void DumpHeap(ostream & out);
 
         // Binds an external function to a message handler for a named global
         // object.
@@ -48,6 +66,7 @@ namespace Finch
         // with that name already exists, will return that slot.
         int DefineGlobal(const String & name);
         const Value & GetGlobal(int index);
+        int NumGlobals() const { return mGlobals.Count(); }
         void SetGlobal(int index, const Value & value);
         
         String FindGlobalName(int index);
@@ -55,9 +74,13 @@ namespace Finch
         // Object constructors.
         Value NewObject(const Value & parent, String name);
         Value NewObject(const Value & parent);
+        Value NewObject(const Value & parent,
+                        const ObjectTemplate & objectTemplate);
         Value NewNumber(double value);
         Value NewString(String value);
         Value NewArray(int capacity);
+        Value NewNumberArray(int count);
+        Value NewMap();
         Value NewBlock(Ref<Block> block, const Value & self);
         Value NewFiber(const Value & block);
         
@@ -65,15 +88,28 @@ namespace Finch
         const Value & Nil()   const { return mNil; }
         const Value & True()  const { return mTrue; }
         const Value & False() const { return mFalse; }
+        const Value & Ether() const { return mEther; }
+        
+        // Gets the shared single-character string for the given character.
+        const Value & Character(char c) const
+        {
+            return mCharacters[static_cast<unsigned char>(c)];
+        }
         
     private:
-        Ref<Expr>   Parse(ILineReader & reader);
+        // Compiles the given top-level expression and runs it to completion in
+        // a new fiber. Returns the result.
+        Value Execute(const Expr & expr);
         
         Value MakeGlobal(const char * name);
         void AddPrimitive(const Value & object, String message,
                           PrimitiveMethod primitive);
         
         IInterpreterHost & mHost;
+        
+        // This has to come before anything that holds a Value, so that it's
+        // still around to count their objects being freed.
+        Heap mHeap;
 
         StringTable mStrings;
         
@@ -87,11 +123,19 @@ namespace Finch
         Value mBlockPrototype;
         Value mFiberPrototype;
         Value mNumberPrototype;
+        Value mNumberArrayPrototype;
+        Value mMapPrototype;
         Value mStringPrototype;
+        Value mEther;
         Value mNil;
         Value mTrue;
         Value mFalse;
         
+        // Preallocated string objects for every single-byte string, indexed
+        // by character, so that reading characters out of a string doesn't
+        // need to allocate.
+        Array<Value> mCharacters;
+        
         NO_COPY(Interpreter);
     };
 }
@@ -1,8 +1,8 @@
 #pragma once
 
-#include "Array.h"
 #include "Macros.h"
 #include "Ref.h"
+#include "RegisterStack.h"
 
 namespace Finch
 {
@@ -12,7 +12,7 @@ namespace Finch
     class ArgReader
     {
     public:
-        ArgReader(Array<Value> & stack, int firstArg, int numArgs)
+        ArgReader(RegisterStack<Value> & stack, int firstArg, int numArgs)
         :   mStack(stack),
             mFirstArg(firstArg),
             mNumArgs(numArgs)
@@ -28,7 +28,7 @@ namespace Finch
         }
 
     private:
-        Array<Value> & mStack;
+        RegisterStack<Value> & mStack;
         int mFirstArg;
         int mNumArgs;
     };
@@ -0,0 +1,211 @@
+#include "CycleCollector.h"
+#include "Heap.h"
+
+namespace Finch
+{
+    CycleCollector::CycleCollector()
+    :   mNumTraced(0)
+    {}
+    
+    int CycleCollector::Collect(const Array<Object *> & roots)
+    {
+        // Objects whose last reference was released while they were buffered
+        // have already let go of everything else and just need to be freed.
+        Array<Object *> candidates;
+        for (int i = 0; i < roots.Count(); i++)
+        {
+            Object * root = roots[i];
+            
+            if (root->mRefCount == 0)
+            {
+                delete root;
+            }
+            else
+            {
+                ASSERT(root->mColor == COLOR_PURPLE,
+                       "Live buffered objects should be purple.");
+                candidates.Add(root);
+            }
+        }
+        
+        for (int i = 0; i < candidates.Count(); i++)
+        {
+            MarkGray(candidates[i]);
+        }
+        
+        for (int i = 0; i < candidates.Count(); i++)
+        {
+            Scan(candidates[i]);
+        }
+        
+        for (int i = 0; i < candidates.Count(); i++)
+        {
+            candidates[i]->mIsBuffered = false;
+            CollectWhite(candidates[i]);
+        }
+        
+        return FreeGarbage();
+    }
+    
+    void CycleCollector::Visit(const Value & value)
+    {
+        Object * object = value.mObj;
+        if ((object != NULL) && !Object::IsAcyclic(object->Kind()))
+        {
+            mChildren.Add(object);
+        }
+    }
+    
+    void CycleCollector::FindChildren(Object * object)
+    {
+        mChildren.Truncate(0);
+        object->VisitReferences(*this);
+    }
+    
+    void CycleCollector::MarkGray(Object * object)
+    {
+        if (object->mColor == COLOR_GRAY) return;
+        
+        object->mColor = COLOR_GRAY;
+        mNumTraced++;
+        mStack.Push(object);
+        
+        while (!mStack.IsEmpty())
+        {
+            FindChildren(mStack.Pop());
+            for (int i = 0; i < mChildren.Count(); i++)
+            {
+                Object * child = mChildren[i];
+                child->mRefCount--;
+                
+                if (child->mColor != COLOR_GRAY)
+                {
+                    child->mColor = COLOR_GRAY;
+                    mNumTraced++;
+                    mStack.Push(child);
+                }
+            }
+        }
+    }
+    
+    void CycleCollector::Scan(Object * object)
+    {
+        mStack.Push(object);
+        
+        while (!mStack.IsEmpty())
+        {
+            Object * gray = mStack.Pop();
+            if (gray->mColor != COLOR_GRAY) continue;
+            
+            if (gray->mRefCount > 0)
+            {
+                // Something outside of the subgraph refers to it.
+                ScanBlack(gray);
+            }
+            else
+            {
+                gray->mColor = COLOR_WHITE;
+                
+                FindChildren(gray);
+                for (int i = 0; i < mChildren.Count(); i++)
+                {
+                    mStack.Push(mChildren[i]);
+                }
+            }
+        }
+    }
+    
+    void CycleCollector::ScanBlack(Object * object)
+    {
+        // This is called in the middle of Scan(), so leave its pending
+        // objects on the stack alone.
+        int base = mStack.Count();
+        
+        object->mColor = COLOR_BLACK;
+        mStack.Push(object);
+        
+        while (mStack.Count() > base)
+        {
+            FindChildren(mStack.Pop());
+            for (int i = 0; i < mChildren.Count(); i++)
+            {
+                Object * child = mChildren[i];
+                child->mRefCount++;
+                
+                if (child->mColor != COLOR_BLACK)
+                {
+                    child->mColor = COLOR_BLACK;
+                    mStack.Push(child);
+                }
+            }
+        }
+    }
+    
+    void CycleCollector::CollectWhite(Object * object)
+    {
+        if (object->mColor != COLOR_WHITE) return;
+        
+        // Garbage is colored green so that releasing the references between
+        // the objects while freeing them doesn't buffer them again.
+        object->mColor = COLOR_GREEN;
+        mGarbage.Add(object);
+        mStack.Push(object);
+        
+        while (!mStack.IsEmpty())
+        {
+            FindChildren(mStack.Pop());
+            for (int i = 0; i < mChildren.Count(); i++)
+            {
+                Object * child = mChildren[i];
+                if (child->mColor == COLOR_WHITE)
+                {
+                    child->mColor = COLOR_GREEN;
+                    mGarbage.Add(child);
+                    mStack.Push(child);
+                }
+            }
+        }
+    }
+    
+    int CycleCollector::FreeGarbage()
+    {
+        // Put back the references MarkGray() subtracted out, so that they
+        // can be released normally. Anything live the garbage referred to
+        // will then be freed or buffered as usual.
+        for (int i = 0; i < mGarbage.Count(); i++)
+        {
+            FindChildren(mGarbage[i]);
+            for (int j = 0; j < mChildren.Count(); j++)
+            {
+                mChildren[j]->mRefCount++;
+            }
+        }
+        
+        // Hold an extra reference to each object so that none of them are
+        // destroyed while the others are still referring to them. Take them
+        // out of their heaps now, while they still know how big they are.
+        int bytes = 0;
+        for (int i = 0; i < mGarbage.Count(); i++)
+        {
+            Object * object = mGarbage[i];
+            object->mRefCount++;
+            bytes += object->GetSize();
+            
+            if (object->mHeap != NULL) object->mHeap->Remove(object);
+        }
+        
+        for (int i = 0; i < mGarbage.Count(); i++)
+        {
+            mGarbage[i]->ReleaseReferences();
+        }
+        
+        for (int i = 0; i < mGarbage.Count(); i++)
+        {
+            ASSERT(mGarbage[i]->mRefCount == 1,
+                   "Garbage should only be referred to by other garbage.");
+            delete mGarbage[i];
+        }
+        
+        return bytes;
+    }
+}
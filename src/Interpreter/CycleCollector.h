@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Array.h"
+#include "Macros.h"
+#include "Object.h"
+#include "Stack.h"
+
+namespace Finch
+{
+    // Frees garbage reference cycles, which refcounting alone never will.
+    // This is the synchronous trial deletion algorithm from Bacon and
+    // Rajan's "Concurrent Cycle Collection in Reference Counted Systems".
+    //
+    // Whenever a reference to an object is released and the object is still
+    // referenced, it may now be only kept alive by a cycle, so it's added to
+    // the buffer of candidate roots in its Heap. A collection walks the
+    // objects reachable from the candidates, subtracting out the references
+    // between them. Any object whose count drops to zero is only referenced
+    // by other garbage, and is freed.
+    //
+    // Only references an object reports through VisitReferences() are
+    // subtracted out. Anything else that holds a value, like the constants
+    // in a compiled Block or the registers of a running fiber, is treated as
+    // a root, so whatever it refers to is never collected.
+    class CycleCollector : public IReferenceVisitor
+    {
+    public:
+        CycleCollector();
+
+        virtual ~CycleCollector() {}
+
+        // Finds and frees all garbage cycles reachable from the given
+        // candidate roots, which have been taken out of their heap's buffer.
+        // Returns the number of bytes used by the objects in them.
+        int Collect(const Array<Object *> & roots);
+
+        // Gets how many objects the collection looked at.
+        int NumTraced() const { return mNumTraced; }
+
+    private:
+        virtual void Visit(const Value & value);
+
+        // Fills mChildren with the objects the given one refers to that may
+        // be part of a cycle.
+        void FindChildren(Object * object);
+
+        // Subtracts out the references between the objects reachable from
+        // the given one and colors them gray.
+        void MarkGray(Object * object);
+
+        // Colors the gray objects reachable from the given one white if
+        // nothing outside of them refers to them, or black otherwise.
+        void Scan(Object * object);
+
+        // Colors the given object and everything reachable from it black and
+        // restores their references.
+        void ScanBlack(Object * object);
+
+        // Moves the white objects reachable from the given one to mGarbage.
+        void CollectWhite(Object * object);
+
+        // Frees the objects in mGarbage. Returns how many bytes they used.
+        int FreeGarbage();
+
+        // How many objects have been colored gray.
+        int mNumTraced;
+
+        // The work list for the traversal being run.
+        Stack<Object *> mStack;
+
+        // The children of the object being traversed.
+        Array<Object *> mChildren;
+
+        // The objects found to be garbage.
+        Array<Object *> mGarbage;
+
+        NO_COPY(CycleCollector);
+    };
+}
@@ -1,12 +1,15 @@
 #include <iostream>
+#include <utility>
 
 #include "ArrayObject.h"
 #include "BlockObject.h"
 #include "Block.h"
 #include "DynamicObject.h"
 #include "FiberObject.h"
+#include "Heap.h"
 #include "IInterpreterHost.h"
 #include "Interpreter.h"
+#include "NumberObject.h"
 #include "Fiber.h"
 
 #ifdef TRACE_INSTRUCTIONS
@@ -26,11 +29,23 @@ namespace Finch
     using std::cout;
     using std::endl;
 
+    uint64_t Fiber::sNextFrameId = 1;
+
+    int Fiber::CallFrame::StackEnd() const
+    {
+        if (IsLoop()) return stackStart;
+        
+        return stackStart + Block().NumRegisters();
+    }
+    
     Fiber::Fiber(Interpreter & interpreter, const Value & block)
     :   mIsRunning(false),
         mInterpreter(interpreter),
-        mStack(),
-        mCallFrames()
+        mAbortError(),
+        mStack(INITIAL_STACK_SIZE, MAX_STACK_SIZE),
+        mCallFrames(),
+        mOpenUpvalues(),
+        mOpenSlots()
     {
         ArgReader args(mStack, 0, 0);
 
@@ -45,7 +60,8 @@ namespace Finch
 
     Value Fiber::Execute()
     {
-        mIsRunning = true;
+        // If the first call was turned down, there's nothing to run.
+        mIsRunning = !IsDone();
 
         // Continue processing bytecode until the entire callstack has returned
         // or we pause and switch to another fiber.
@@ -74,7 +90,16 @@ namespace Finch
                     // will be placed into.
                     const Value & parent = Load(frame, a);
                     Value object = mInterpreter.NewObject(parent);
-                    Store(frame, a, object);
+                    Store(frame, a, std::move(object));
+                    break;
+                }
+
+                case OP_OBJECT_TEMPLATE:
+                {
+                    const Value & parent = Load(frame, a);
+                    Value object = mInterpreter.NewObject(parent,
+                        frame.Block().GetTemplate(b));
+                    Store(frame, a, std::move(object));
                     break;
                 }
 
@@ -82,11 +107,50 @@ namespace Finch
                 {
                     // Create a new block object from the block.
                     Ref<Block> block = frame.Block().GetBlock(a);
+                    
+                    // A block with no upvalues is only distinguished by its
+                    // self, so reuse the last one made if that matches.
+                    if ((block->NumUpvalues() == 0) &&
+                        (block->NumCaptures() == 0) &&
+                        !block->HasNonLocalReturn())
+                    {
+                        size_t hash = reinterpret_cast<size_t>(&*block) >> 4;
+                        Value & cached = mBlockCache[hash % BLOCK_CACHE_SIZE];
+                        
+                        if (cached.IsNull() ||
+                            !cached.AsBlock()->IsFrom(*block) ||
+                            (cached.AsBlock()->Self() != Self()))
+                        {
+                            cached = mInterpreter.NewBlock(block, Self());
+                        }
+                        
+                        Store(frame, b, cached);
+                        break;
+                    }
+                    
                     Value blockObj = mInterpreter.NewBlock(block, Self());
                     BlockObject * blockPtr = blockObj.AsBlock();
 
+                    // If it can return from the method, remember which call
+                    // that is. Blocks created inside other blocks share the
+                    // home of the outermost one.
+                    if (block->HasNonLocalReturn())
+                    {
+                        if (frame.Block().MethodId() != Block::BLOCK_METHOD_ID)
+                        {
+                            blockPtr->SetHomeFrame(mCallFrames.Count() - 1,
+                                                   frame.id);
+                        }
+                        else
+                        {
+                            blockPtr->SetHomeFrame(frame.Block().HomeFrame(),
+                                                   frame.Block().HomeFrameId());
+                        }
+                    }
+
                     // Capture upvalues.
-                    for (int i = 0; i < block->NumUpvalues(); i++)
+                    int numCaptures = block->NumUpvalues() + block->NumCaptures();
+                    for (int i = 0; i < numCaptures; i++)
                     {
                         Instruction capture = frame.Block().Code()[frame.ip++];
                         OpCode captureOp = DECODE_OP(capture);
@@ -103,12 +167,20 @@ namespace Finch
                                 blockPtr->AddUpvalue(frame.Block().GetUpvalue(captureIndex));
                                 break;
 
+                            case OP_COPY_LOCAL:
+                                blockPtr->AddCapture(Load(frame, captureIndex));
+                                break;
+
+                            case OP_COPY_CAPTURE:
+                                blockPtr->AddCapture(frame.Block().GetCapture(captureIndex));
+                                break;
+
                             default:
                                 ASSERT(false, "Unexpected capture pseudo-op.");
                         }
                     }
 
-                    Store(frame, b, blockObj);
+                    Store(frame, b, std::move(blockObj));
                     break;
                 }
 
@@ -117,7 +189,7 @@ namespace Finch
                     // Create the empty array with enough capacity. Subsequent
                     // OP_ARRAY_ELEMENT instructions will fill it.
                     Value array = mInterpreter.NewArray(a);
-                    Store(frame, b, array);
+                    Store(frame, b, std::move(array));
                     break;
                 }
 
@@ -125,8 +197,7 @@ namespace Finch
                 {
                     // Add the item to the array.
                     const Value & element = Load(frame, a);
-                    Value array = Load(frame, b);
-                    array.AsArray()->Elements().Add(element);
+                    Load(frame, b).AsArray()->Add(element);
                     break;
                 }
 
@@ -164,7 +235,9 @@ namespace Finch
                     // setting the result on the caller.
                     if (!result.IsNull())
                     {
-                        Store(frame, c, result);
+                        // Look the frame up again: a primitive that ran a
+                        // native loop may have pushed frames and moved it.
+                        Store(mCallFrames.Peek(), c, std::move(result));
                     }
                     break;
                 }
@@ -183,13 +256,17 @@ namespace Finch
                     break;
                 }
 
+                case OP_GET_CAPTURE:
+                    Store(frame, b, frame.Block().GetCapture(a));
+                    break;
+
                 case OP_GET_FIELD:
                 {
                     Value field = Self().GetField(a);
                     // TODO(bob): Just make a null Value equivalent to nil.
                     if (!field.IsNull())
                     {
-                        Store(frame, b, field);
+                        Store(frame, b, std::move(field));
                     }
                     else
                     {
@@ -256,7 +333,7 @@ namespace Finch
 
                 case OP_END:
                 {
-                    const Value & result = Load(frame, a);
+                    Value result = Take(frame, a);
                     PopCallFrame();
 
                     if (mCallFrames.Count() > 0)
@@ -277,26 +354,27 @@ namespace Finch
                 {
                     int methodId = a;
 
-                    const Value & result = Load(frame, b);
+                    Value result = Take(frame, b);
 
-                    // Find the enclosing method on the callstack.
-                    int methodFrame;
-                    for (methodFrame = 0; methodFrame < mCallFrames.Count(); methodFrame++)
+                    // Find the enclosing method on the callstack. A return
+                    // inside a block goes to the frame the block was created
+                    // in, as long as that call hasn't returned already.
+                    int methodFrame = 0;
+                    if (frame.Block().MethodId() != methodId)
                     {
-                        if (mCallFrames[methodFrame].Block().MethodId() == methodId)
+                        int home = frame.Block().HomeFrame();
+                        methodFrame = mCallFrames.Count() - 1 - home;
+
+                        if ((home < 0) || (methodFrame < 0) ||
+                            (mCallFrames[methodFrame].id !=
+                             frame.Block().HomeFrameId()))
                         {
-                            // Found it.
-                            break;
+                            Error("Cannot return from a block whose enclosing method has already returned.");
+                            // Unwind the whole stack.
+                            methodFrame = mCallFrames.Count() - 1;
                         }
                     }
 
-                    if (methodFrame == mCallFrames.Count())
-                    {
-                        Error("Cannot return from a block whose enclosing method has already returned.");
-                        // Unwind the whole stack.
-                        methodFrame = mCallFrames.Count() - 1;
-                    }
-
                     // Unwind until we reach the method.
                     while (methodFrame >= 0)
                     {
@@ -317,6 +395,72 @@ namespace Finch
                     break;
                 }
 
+                case OP_FOR_PREP:
+                {
+                    int numArgs = b;
+                    
+                    // If the loop can't run inline, skip FOR_LOOP and just
+                    // send the message that follows it.
+                    if (!CanRunCountedLoop(frame, a, numArgs))
+                    {
+                        frame.ip++;
+                        break;
+                    }
+                    
+                    double start = Load(frame, a + 1).AsNumber();
+                    double end = Load(frame, a + 2).AsNumber();
+                    double step;
+                    if (numArgs == 4)
+                    {
+                        step = Load(frame, a + 3).AsNumber();
+                    }
+                    else
+                    {
+                        step = (start <= end) ? 1 : -1;
+                    }
+                    
+                    StoreNumber(frame, a + numArgs + 1, start);
+                    StoreNumber(frame, a + numArgs + 2, step);
+                    
+                    if (start <= end)
+                    {
+                        // When the block returns, FOR_LOOP will run next.
+                        CallCountedLoopBody(frame, a, numArgs, start);
+                    }
+                    else
+                    {
+                        // Skip FOR_LOOP and the message.
+                        Store(frame, c, Nil());
+                        frame.ip += 2;
+                    }
+                    break;
+                }
+                
+                case OP_FOR_LOOP:
+                {
+                    int numArgs = b;
+                    
+                    double index = Load(frame, a + numArgs + 1).AsNumber() +
+                                   Load(frame, a + numArgs + 2).AsNumber();
+                    
+                    if (index <= Load(frame, a + 2).AsNumber())
+                    {
+                        StoreNumber(frame, a + numArgs + 1, index);
+                        
+                        // Come back to this instruction when the block
+                        // returns.
+                        frame.ip--;
+                        CallCountedLoopBody(frame, a, numArgs, index);
+                    }
+                    else
+                    {
+                        // Done, so skip the message.
+                        Store(frame, c, Nil());
+                        frame.ip++;
+                    }
+                    break;
+                }
+                
                 default:
                     std::cout << op << std::endl;
                     ASSERT(false, "Unknown opcode.");
@@ -325,41 +469,75 @@ namespace Finch
             TRACE_STACK();
         }
 
+        // If a call ran out of stack or memory, give up on the whole fiber.
+        if (mAbortError.Length() > 0)
+        {
+            Error(mAbortError);
+            mAbortError = "";
+
+            while (mCallFrames.Count() > 0) PopCallFrame();
+        }
+
         return Value();
     }
 
-    Value Fiber::Load(const CallFrame & frame, int reg)
+    const Value & Fiber::Load(const CallFrame & frame, int reg)
     {
         return mStack[frame.stackStart + reg];
     }
 
+    Value Fiber::Take(const CallFrame & frame, int reg)
+    {
+        int slot = frame.stackStart + reg;
+        if ((slot < mOpenUpvalues.Count()) && !mOpenUpvalues[slot].IsNull())
+        {
+            return mStack[slot];
+        }
+        
+        return std::move(mStack[slot]);
+    }
+
     void Fiber::Store(const CallFrame & frame, int reg, const Value & value)
     {
         mStack[frame.stackStart + reg] = value;
     }
 
+    void Fiber::Store(const CallFrame & frame, int reg, Value && value)
+    {
+        mStack[frame.stackStart + reg] = std::move(value);
+    }
+
     void Fiber::PopCallFrame()
     {
-        CallFrame & frame = mCallFrames.Peek();
-        int oldStackSize = frame.stackStart + frame.Block().NumRegisters();
+        int oldStackStart = mCallFrames.Peek().stackStart;
+        int oldStackSize = mCallFrames.Peek().StackEnd();
         mCallFrames.Pop();
 
         // Discard the callee frame's registers.
         int newStackSize = 0;
         if (mCallFrames.Count() > 0)
         {
-            CallFrame & caller = mCallFrames.Peek();
-            newStackSize = caller.stackStart + caller.Block().NumRegisters();
+            newStackSize = mCallFrames.Peek().StackEnd();
+        }
+        else
+        {
+            // The fiber is done, so don't let cached blocks keep their selfs
+            // alive.
+            for (int i = 0; i < BLOCK_CACHE_SIZE; i++) mBlockCache[i].Clear();
         }
 
-        // Close any open upvalues that are being popped off
-        // the stack.
-        while (!mOpenUpvalues.IsNull())
+        // Close any open upvalues that are being popped off the stack. The
+        // callee's parameters are in registers that overlap the caller's, so
+        // this has to go by where the callee's frame started, not where the
+        // caller's ends.
+        while (mOpenSlots.Count() > 0)
         {
-            if (mOpenUpvalues->Index() < newStackSize) break;
+            int slot = mOpenSlots[-1];
+            if (slot < oldStackStart) break;
 
-            mOpenUpvalues->Close(mStack);
-            mOpenUpvalues = mOpenUpvalues->Next();
+            mOpenUpvalues[slot]->Close(mStack);
+            mOpenUpvalues[slot].Clear();
+            mOpenSlots.RemoveAt(-1);
         }
 
         // Clear any discarded registers on the stack. Note that we don't
@@ -381,17 +559,26 @@ namespace Finch
         // Instead, we'll just *clear* the popped registers (because we know
         // they aren't in use after the call even though they may get used
         // again) but keep them around in case later callers need them.
-        for (int i = newStackSize; i < oldStackSize; i++)
-        {
-            mStack[i] = Value();
-        }
+        mStack.Clear(newStackSize, oldStackSize);
     }
 
     void Fiber::StoreMessageResult(const Value & result)
     {
-        // Store the result back in the caller's dest register.
         CallFrame & caller = mCallFrames.Peek();
+        
+        // A native loop called this block, so let it take its next step.
+        if (caller.IsLoop())
+        {
+            ResumeLoop(result);
+            return;
+        }
+        
+        // Store the result back in the caller's dest register.
         Instruction instruction = caller.Block().Code()[caller.ip - 1];
+        
+        // A counted loop called this block, so discard the result. FOR_LOOP
+        // will run next to take the next step.
+        if (DECODE_OP(instruction) == OP_FOR_PREP) return;
 
         ASSERT((DECODE_OP(instruction) >= OP_MESSAGE_0) &&
                (DECODE_OP(instruction) <= OP_MESSAGE_10),
@@ -401,6 +588,51 @@ namespace Finch
         Store(caller, dest, result);
     }
 
+    void Fiber::StoreNumber(const CallFrame & frame, int reg, double value)
+    {
+        // Loops store a new number each time around, so reuse the old one if
+        // nothing else has a reference to it.
+        Value & slot = mStack[frame.stackStart + reg];
+        if (!slot.TrySetNumber(value)) slot = CreateNumber(value);
+    }
+    
+    bool Fiber::CanRunCountedLoop(const CallFrame & frame, int receiverReg,
+                                  int numArgs)
+    {
+        // The message that OP_FOR_PREP falls back to follows OP_FOR_LOOP.
+        Instruction send = frame.Block().Code()[frame.ip + 1];
+        StringId messageId = DECODE_A(send);
+        
+        // The inline loop does the same thing as Ether's primitive, so it can
+        // only be used if that's what the message would run. Methods are
+        // found before primitives, so make sure one hasn't been defined.
+        const Value & ether = mInterpreter.Ether();
+        if (Load(frame, receiverReg) != ether) return false;
+        
+        // Leave bounds that aren't numbers to the primitive to report.
+        for (int i = 1; i < numArgs; i++)
+        {
+            if (!Load(frame, receiverReg + i).IsNumber()) return false;
+        }
+        
+        DynamicObject::Method method;
+        return !ether.AsDynamic()->FindMethod(messageId, &method) ||
+               method.block.IsNull();
+    }
+    
+    void Fiber::CallCountedLoopBody(const CallFrame & frame, int receiverReg,
+                                    int numArgs, double index)
+    {
+        // Pass the index in the register after the loop's state. The block's
+        // registers start there.
+        int argReg = receiverReg + numArgs + 3;
+        StoreNumber(frame, argReg, index);
+        
+        ArgReader args(mStack, frame.stackStart + argReg, 1);
+        const Value & blockObj = Load(frame, receiverReg + numArgs);
+        CallBlock(blockObj.AsBlock()->Self(), blockObj, args);
+    }
+    
     Value Fiber::SendMessage(StringId messageId, int receiverReg, int numArgs)
     {
         const Value & self = Load(mCallFrames.Peek(), receiverReg);
@@ -434,26 +666,199 @@ namespace Finch
         return mInterpreter.NewString(value);
     }
 
+    const Value & Fiber::CreateCharacter(char c)
+    {
+        return mInterpreter.Character(c);
+    }
+
     void Fiber::CallBlock(const Value & receiver, const Value & blockObj, const ArgReader & args)
     {
+        // Look for garbage cycles every so often. Anything the fiber is still
+        // using is held by a register, a callframe, or a Value in the caller,
+        // so none of it can be collected out from under it.
+        Heap & heap = mInterpreter.GetHeap();
+        if (heap.ShouldCollect()) heap.Collect();
+        
+        // This is also where the heap limits are checked. Going over the hard
+        // one stops the fiber, the same as running out of stack.
+        if (heap.NeedsCheck() && !heap.Check())
+        {
+            Abort(heap.LimitError());
+            return;
+        }
+        
         BlockObject & block = *(blockObj.AsBlock());
 
+        // The receiver and block may be borrowed from registers, which will
+        // move if the stack grows, so copy them into the frame first.
+        CallFrame frame(args.StackStart(), receiver, blockObj);
+
         // Allocate this frame's registers.
-        // TODO(bob): Make this a single operation on Array.
-        while (mStack.Count() < args.StackStart() + block.NumRegisters())
-        {
-            mStack.Add(Value());
-        }
+        if (!EnsureStack(args.StackStart() + block.NumRegisters())) return;
 
         // If there aren't enough arguments, nil out the remaining parameters.
-        for (int i = args.NumArgs(); i < block.NumParams(); i++)
+        if (args.NumArgs() < block.NumParams())
         {
-            mStack[args.StackStart() + i] = Nil();
+            mStack.Fill(args.StackStart() + args.NumArgs(),
+                        block.NumParams() - args.NumArgs(), Nil());
         }
 
-        mCallFrames.Push(CallFrame(args.StackStart(), receiver, blockObj));
+        mCallFrames.Push(std::move(frame));
     }
 
+    Value Fiber::StartLoop(INativeLoop * loop)
+    {
+        // The blocks the loop calls get their registers past the caller's.
+        Ref<INativeLoop> loopRef(loop);
+        mCallFrames.Push(CallFrame(mCallFrames.Peek().StackEnd(), loopRef));
+        
+        Value result = loop->Step(*this, Value());
+        
+        // If it finished right away, the primitive can return the result.
+        if (!result.IsNull()) PopCallFrame();
+        return result;
+    }
+    
+    bool Fiber::ExpectBlock(const Value & value)
+    {
+        if (value.AsBlock() != NULL) return true;
+        
+        Error("Must pass in a block object.");
+        return false;
+    }
+    
+    void Fiber::CallLoopBlock(const Value & blockObj)
+    {
+        CallFrame & frame = mCallFrames.Peek();
+        ASSERT(frame.IsLoop(), "Only a native loop can call a loop block.");
+        
+        ArgReader args(mStack, frame.stackStart, 0);
+        CallBlock(blockObj.AsBlock()->Self(), blockObj, args);
+    }
+    
+    void Fiber::CallLoopBlock(const Value & blockObj, const Value & arg)
+    {
+        CallFrame & frame = mCallFrames.Peek();
+        ASSERT(frame.IsLoop(), "Only a native loop can call a loop block.");
+        
+        int stackStart = frame.stackStart;
+        if (!EnsureStack(stackStart + 1)) return;
+        mStack[stackStart] = arg;
+        
+        ArgReader args(mStack, stackStart, 1);
+        CallBlock(blockObj.AsBlock()->Self(), blockObj, args);
+    }
+    
+    void Fiber::CallLoopBlock(const Value & blockObj, const Value & arg1,
+                              const Value & arg2)
+    {
+        CallFrame & frame = mCallFrames.Peek();
+        ASSERT(frame.IsLoop(), "Only a native loop can call a loop block.");
+        
+        int stackStart = frame.stackStart;
+        if (!EnsureStack(stackStart + 2)) return;
+        mStack[stackStart] = arg1;
+        mStack[stackStart + 1] = arg2;
+        
+        ArgReader args(mStack, stackStart, 2);
+        CallBlock(blockObj.AsBlock()->Self(), blockObj, args);
+    }
+    
+    void Fiber::ResumeLoop(const Value & result)
+    {
+        // Copy the reference since calling the next block may move the frame.
+        Ref<INativeLoop> loop = mCallFrames.Peek().loop;
+        
+        Value loopResult = loop->Step(*this, result);
+        if (loopResult.IsNull()) return;
+        
+        // The loop is done, so return its result to whoever started it.
+        PopCallFrame();
+        StoreMessageResult(loopResult);
+    }
+    
+    bool Fiber::EnsureStack(int size)
+    {
+        int oldSize = StackSize();
+        
+        if (!mStack.Ensure(size))
+        {
+            Abort("Stack overflow.");
+            return false;
+        }
+        
+        // The registers are counted as part of the FiberObject.
+        int newSize = StackSize();
+        if (newSize != oldSize)
+        {
+            mInterpreter.GetHeap().Resize(OBJECT_FIBER, oldSize, newSize);
+        }
+        
+        return true;
+    }
+    
+    void Fiber::Abort(const String & error)
+    {
+        mAbortError = error;
+        mIsRunning = false;
+    }
+    
+    bool Fiber::EnsureHeap(size_t bytes)
+    {
+        Heap & heap = mInterpreter.GetHeap();
+        if (heap.CanAllocate(bytes)) return true;
+        
+        // Collecting may free up enough.
+        if (heap.Check() && heap.CanAllocate(bytes)) return true;
+        
+        Abort(heap.LimitError());
+        return false;
+    }
+    
+    int Fiber::StackSize() const
+    {
+        return mStack.Capacity() * static_cast<int>(sizeof(Value));
+    }
+    
+    void Fiber::VisitReferences(IReferenceVisitor & visitor) const
+    {
+        // A running fiber borrows values out of its registers without
+        // counting them and changes its frames as it goes, so everything it
+        // refers to is left as a root until it stops.
+        if (IsRunning()) return;
+        
+        for (int i = 0; i < mStack.Count(); i++)
+        {
+            visitor.Visit(mStack[i]);
+        }
+        
+        // Native loops are left as roots too, like they are in a running
+        // fiber. Open upvalues point at the registers above, and once
+        // they're closed they belong to the blocks that captured them, which
+        // are visited through the frames.
+        for (int i = 0; i < mCallFrames.Count(); i++)
+        {
+            visitor.Visit(mCallFrames[i].receiver);
+            visitor.Visit(mCallFrames[i].block);
+        }
+        
+        for (int i = 0; i < BLOCK_CACHE_SIZE; i++)
+        {
+            visitor.Visit(mBlockCache[i]);
+        }
+    }
+    
+    void Fiber::ReleaseReferences()
+    {
+        while (!mCallFrames.IsEmpty()) mCallFrames.Pop();
+        
+        mOpenUpvalues.Clear();
+        mOpenSlots.Clear();
+        mStack.Clear(0, mStack.Count());
+        
+        for (int i = 0; i < BLOCK_CACHE_SIZE; i++) mBlockCache[i].Clear();
+    }
+    
     void Fiber::Error(const String & message)
     {
         mInterpreter.GetHost().Error(message);
@@ -464,49 +869,40 @@ namespace Finch
         return mCallFrames.Count();
     }
 
-    Ref<Upvalue> Fiber::CaptureUpvalue(int stackIndex)
+    bool Fiber::GetCurrentSite(AllocationSite * site) const
     {
-        // If there are no open upvalues at all, we must need a new one.
-        if (mOpenUpvalues.IsNull())
+        for (int i = 0; i < mCallFrames.Count(); i++)
         {
-            mOpenUpvalues = Ref<Upvalue>(new Upvalue(stackIndex));
-            return mOpenUpvalues;
+            const CallFrame & frame = mCallFrames[i];
+            if (frame.IsLoop()) continue;
+            
+            // The instruction pointer has already moved past the instruction
+            // being executed.
+            site->block = frame.Block().GetCompiledBlock();
+            site->ip = (frame.ip > 0) ? frame.ip - 1 : 0;
+            return true;
         }
+        
+        return false;
+    }
 
-        Ref<Upvalue> prevUpvalue;
-        Ref<Upvalue> upvalue = mOpenUpvalues;
-        while (true)
+    Ref<Upvalue> Fiber::CaptureUpvalue(int stackIndex)
+    {
+        // Reuse the open upvalue for the slot if there is one so that every
+        // block closing over the variable shares it.
+        while (mOpenUpvalues.Count() <= stackIndex)
         {
-            if (upvalue.IsNull() || (upvalue->Index() < stackIndex))
-            {
-                // We've gone past this item on the stack, so there must not be
-                // an open upvalue for it. Make a new one and link it in in the
-                // right place to keep the list sorted.
-                Ref<Upvalue> newUpvalue = Ref<Upvalue>(new Upvalue(stackIndex));
-
-                if (prevUpvalue.IsNull())
-                {
-                    // Our new one is the first one in the list.
-                    mOpenUpvalues = newUpvalue;
-                }
-                else
-                {
-                    prevUpvalue->SetNext(newUpvalue);
-                }
-                newUpvalue->SetNext(upvalue);
-
-                return newUpvalue;
-            }
-            else if (upvalue->Index() == stackIndex)
-            {
-                // Already have an open upvalue, so use it.
-                return upvalue;
-            }
-
-            // Walk towards the bottom of the stack.
-            prevUpvalue = upvalue;
-            upvalue = upvalue->Next();
+            mOpenUpvalues.Add(Ref<Upvalue>());
+        }
+        
+        Ref<Upvalue> & upvalue = mOpenUpvalues[stackIndex];
+        if (upvalue.IsNull())
+        {
+            upvalue = Ref<Upvalue>(new Upvalue(stackIndex));
+            mOpenSlots.Add(stackIndex);
         }
+
+        return upvalue;
     }
 
 #ifdef TRACE_INSTRUCTIONS
@@ -533,6 +929,11 @@ namespace Finch
                 action = String::Format("-> %d", a);
                 break;
 
+            case OP_OBJECT_TEMPLATE:
+                opName = "OBJECT_TEMPLATE";
+                action = String::Format("t%d -> %d", b, a);
+                break;
+
             case OP_BLOCK:
                 opName = "BLOCK";
                 action = String::Format("b%d -> %d", a, b);
@@ -586,6 +987,11 @@ namespace Finch
                 action = String::Format("u%d <- %d", a, b);
                 break;
 
+            case OP_GET_CAPTURE:
+                opName = "GET_CAPTURE";
+                action = String::Format("c%d -> %d", a, b);
+                break;
+
             case OP_GET_FIELD:
             {
                 opName = "GET_FIELD";
@@ -644,6 +1050,16 @@ namespace Finch
                 action = String::Format("m%d ^ %d", a, b);
                 break;
 
+            case OP_FOR_PREP:
+                opName = "FOR_PREP";
+                action = String::Format("%d (%d) -> %d", a, b, c);
+                break;
+
+            case OP_FOR_LOOP:
+                opName = "FOR_LOOP";
+                action = String::Format("%d (%d) -> %d", a, b, c);
+                break;
+
             default:
                 opName = String::Format("UNKNOWN OP(%d)", op);
                 action = "";
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "Block.h"
+#include "BlockObject.h"
+#include "INativeLoop.h"
 #include "Macros.h"
 #include "Object.h"
 #include "Ref.h"
@@ -11,6 +15,7 @@
 
 namespace Finch
 {
+    struct AllocationSite;
     class Environment;
     class Expr;
     class Interpreter;
@@ -37,16 +42,58 @@ namespace Finch
         const Value & CreateBool(bool value);
         Value CreateNumber(double value);
         Value CreateString(const String & value);
+        const Value & CreateCharacter(char c);
         
         // Pushes the given block onto the call stack.
         void CallBlock(const Value & receiver, const Value & blockObj, const ArgReader & args);
 
+        // Starts running a native loop for a primitive, taking ownership of
+        // it. If the loop finishes without calling any blocks, returns its
+        // result. Otherwise returns a null Value, and the loop's result will
+        // be stored when it finishes, just like a method call's.
+        Value StartLoop(INativeLoop * loop);
+        
+        // Native loops call blocks directly instead of sending them call:, so
+        // they only accept real blocks. Returns true if the given value is
+        // one. Otherwise reports an error and returns false.
+        bool ExpectBlock(const Value & value);
+        
+        // Calls the given block from the native loop on top of the callstack.
+        void CallLoopBlock(const Value & blockObj);
+        void CallLoopBlock(const Value & blockObj, const Value & arg);
+        void CallLoopBlock(const Value & blockObj, const Value & arg1,
+                           const Value & arg2);
+
         // Displays a runtime error to the user.
         void Error(const String & message);
         
+        // Makes sure the given number of bytes can be allocated without
+        // going over the interpreter's hard heap limit. If they can't, stops
+        // the fiber so that Execute() can report it, and returns false.
+        // Primitives that make a single allocation whose size the script
+        // picks check this first, since it could be too big to survive until
+        // the limit is next checked.
+        bool EnsureHeap(size_t bytes);
+        
+        // Gets the number of bytes used by the fiber's registers.
+        int StackSize() const;
+        
         // Gets the current number of stack frames on the callstack. Used as a
         // diagnostic to ensure that tail call optimization is working.
         int GetCallstackDepth() const;
+        
+        // Passes each value the fiber refers to to the visitor, if it isn't
+        // running. See Object::VisitReferences().
+        void VisitReferences(IReferenceVisitor & visitor) const;
+        
+        // Releases every value the fiber refers to, leaving it done.
+        void ReleaseReferences();
+        
+        // Gets the block and instruction the fiber is running. Native loops
+        // are skipped over to the block that started them. Returns false if
+        // nothing is running.
+        bool GetCurrentSite(AllocationSite * site) const;
+        
     private:
         // A single stack frame on the virtual callstack.
         struct CallFrame
@@ -64,33 +111,99 @@ namespace Finch
             // The block of code being executed by this frame.
             Value block;
             
+            // If this frame is running a native loop instead of a block, the
+            // loop. Blocks it calls return their results to it.
+            Ref<INativeLoop> loop;
+            
+            // Identifies this call among all of the ones made by any fiber, so
+            // that a block returning from its method can tell if the frame it
+            // was created in is still the one at the same depth. It's 64 bits
+            // so that it never wraps around to reuse an id that a block may
+            // still be holding onto. Native loop frames have the id 0.
+            uint64_t id;
+            
             CallFrame()
             :   ip(0),
                 stackStart(0),
                 receiver(),
-                block()
+                block(),
+                loop(),
+                id(0)
             {}
             
             CallFrame(int stackStart, const Value & receiver, const Value & block)
             :   ip(0),
                 stackStart(stackStart),
                 receiver(receiver),
-                block(block)
+                block(block),
+                loop(),
+                id(sNextFrameId++)
+            {}
+            
+            CallFrame(int stackStart, const Ref<INativeLoop> & loop)
+            :   ip(0),
+                stackStart(stackStart),
+                receiver(),
+                block(),
+                loop(loop),
+                id(0)
             {}
 
+            bool IsLoop() const { return !loop.IsNull(); }
+            
             // Gets the code object for this frame.
             const BlockObject & Block() const { return *(block.AsBlock()); }
+            
+            // Gets the index on the stack just past this frame's registers.
+            // A native loop has no registers of its own.
+            int StackEnd() const;
         };
         
-        // Loads a register for the given callframe.
-        Value Load(const CallFrame & frame, int reg);
+        // Loads a register for the given callframe. This borrows the value
+        // in the register instead of copying it, so it doesn't touch its
+        // refcount. The reference is only good until the register is
+        // written or the stack grows, which only happens in CallBlock().
+        const Value & Load(const CallFrame & frame, int reg);
+        
+        // Moves the value out of a register in a frame that is about to be
+        // popped. Copies it instead if a block has captured the register,
+        // since the upvalue will still need it when it's closed.
+        Value Take(const CallFrame & frame, int reg);
         
         // Stores a register for the given callframe.
         void Store(const CallFrame & frame, int reg, const Value & value);
+        void Store(const CallFrame & frame, int reg, Value && value);
 
         void PopCallFrame();
         void StoreMessageResult(const Value & result);
+        
+        // Passes the result of a block call to the native loop that called
+        // it and finishes the loop if that was its last step.
+        void ResumeLoop(const Value & result);
+        
+        // Makes sure the stack has at least size registers. If it can't grow
+        // that much, stops the fiber so that Execute() can report the stack
+        // overflow, and returns false.
+        bool EnsureStack(int size);
+        
+        // Stops the fiber. Once the instruction being executed is done,
+        // Execute() reports the given error and unwinds the callstack.
+        void Abort(const String & error);
 
+        // Stores a number in a register, reusing the number already there
+        // if possible.
+        void StoreNumber(const CallFrame & frame, int reg, double value);
+        
+        // Gets whether the counted loop whose receiver is in the given
+        // register, followed by its arguments, can be run inline by
+        // OP_FOR_PREP and OP_FOR_LOOP.
+        bool CanRunCountedLoop(const CallFrame & frame, int receiverReg,
+                               int numArgs);
+        
+        // Calls the block for a counted loop with the given index.
+        void CallCountedLoopBody(const CallFrame & frame, int receiverReg,
+                                 int numArgs, double index);
+        
         Value SendMessage(StringId messageId, int receiverReg, int numArgs);
         
         const Value & Self();
@@ -102,14 +215,36 @@ namespace Finch
         void TraceStack();
 #endif
         
+        // The stack starts with room for this many registers, and running
+        // out of room beyond the maximum is a stack overflow.
+        static const int INITIAL_STACK_SIZE = 1024;
+        static const int MAX_STACK_SIZE = 1 << 22;
+        
+        static uint64_t sNextFrameId;
+        
         bool mIsRunning;
         Interpreter & mInterpreter;
-        Array<Value>  mStack;
+        
+        // The error to report once the fiber stops, if it was aborted.
+        String mAbortError;
+        
+        RegisterStack<Value> mStack;
         Stack<CallFrame>     mCallFrames;
         
-        // Reference to first upvalue in list of open upvalues. List is ordered
-        // from top of stack down.
-        Ref<Upvalue> mOpenUpvalues;
+        // Open upvalues indexed by the stack slot they refer to. Slots with
+        // no open upvalue have a null Ref.
+        Array<Ref<Upvalue> > mOpenUpvalues;
+        
+        // The stack slots that have open upvalues, in the order they were
+        // opened. A frame only captures its own registers, and those are
+        // above its caller's locals, so the upvalues for the frame on top of
+        // the callstack are always at the end.
+        Array<int> mOpenSlots;
+        
+        // Recently created blocks that have no upvalues, hashed by their
+        // Block. Evaluating one again with the same self reuses the object.
+        static const int BLOCK_CACHE_SIZE = 64;
+        Value mBlockCache[BLOCK_CACHE_SIZE];
         
         NO_COPY(Fiber);
     };
@@ -0,0 +1,189 @@
+#include <utility>
+
+#include "Heap.h"
+#include "CycleCollector.h"
+#include "Fiber.h"
+
+namespace Finch
+{
+    Heap::Heap()
+    :   mSoftLimit(0),
+        mHardLimit(0),
+        mNextCheck(0),
+        mLiveBytes(0),
+        mBlockBytes(0),
+        mNumBlocks(0),
+        mRoots(),
+        mCollectThreshold(MIN_COLLECT_THRESHOLD),
+        mSites(NULL),
+        mRunningFiber(NULL)
+    {
+        for (int i = 0; i < NUM_KINDS; i++)
+        {
+            mKindBytes[i] = 0;
+            mKindCounts[i] = 0;
+        }
+
+        UpdateNextCheck();
+    }
+
+    Heap::~Heap()
+    {
+        // Objects in garbage cycles aren't freed along with the rest of the
+        // interpreter, and they still point here, so free them while this
+        // heap is still around to take them out. Freeing one cycle can
+        // release the last outside reference to another, so keep going until
+        // there are none left.
+        while (Collect() > 0) {}
+
+        // Releasing the sites' blocks can free objects, which will try to
+        // take their own sites out.
+        Dictionary<const Object *, AllocationSite> * sites = mSites;
+        mSites = NULL;
+        delete sites;
+    }
+
+    void Heap::SetLimits(size_t softLimit, size_t hardLimit)
+    {
+        mSoftLimit = softLimit;
+        mHardLimit = hardLimit;
+        UpdateNextCheck();
+    }
+
+    int Heap::Collect()
+    {
+        // Take the roots so that objects released while the garbage is being
+        // freed are buffered for the next collection.
+        Array<Object *> roots = std::move(mRoots);
+
+        CycleCollector collector;
+        int bytes = collector.Collect(roots);
+
+        // Collecting walks everything reachable from the roots, so wait for
+        // at least that many roots before doing it again. That keeps the
+        // cost per released reference constant when there's a lot of live
+        // data.
+        mCollectThreshold = collector.NumTraced();
+        if (mCollectThreshold < MIN_COLLECT_THRESHOLD)
+        {
+            mCollectThreshold = MIN_COLLECT_THRESHOLD;
+        }
+
+        return bytes;
+    }
+
+    bool Heap::Check()
+    {
+        Collect();
+        UpdateNextCheck();
+
+        return (mHardLimit == 0) || (mLiveBytes <= mHardLimit);
+    }
+
+    bool Heap::CanAllocate(size_t bytes) const
+    {
+        if (mHardLimit == 0) return true;
+
+        return (bytes <= mHardLimit) && (mLiveBytes <= mHardLimit - bytes);
+    }
+
+    String Heap::LimitError() const
+    {
+        return String::Format("Out of memory. The heap is limited to %lu bytes.",
+                              static_cast<unsigned long>(mHardLimit));
+    }
+
+    void Heap::Remove(Object * object)
+    {
+        ObjectKind kind = object->Kind();
+        size_t size = static_cast<size_t>(object->GetSize());
+
+        object->mHeap = NULL;
+        mLiveBytes -= size;
+        mKindBytes[kind] -= size;
+        mKindCounts[kind]--;
+
+        if (mSites != NULL)
+        {
+            // Hang on to the site until it's out of the table. If it has the
+            // last reference to its block, freeing the block frees the
+            // block's constants, which comes back here.
+            AllocationSite site;
+            if (mSites->Find(object, &site)) mSites->Remove(object);
+        }
+    }
+
+    void Heap::Resize(ObjectKind kind, int oldSize, int newSize)
+    {
+        mLiveBytes = mLiveBytes - oldSize + newSize;
+        mKindBytes[kind] = mKindBytes[kind] - oldSize + newSize;
+    }
+
+    void Heap::AddBlock(int size)
+    {
+        mLiveBytes += size;
+        mBlockBytes += size;
+        mNumBlocks++;
+    }
+
+    void Heap::RemoveBlock(int size)
+    {
+        mLiveBytes -= size;
+        mBlockBytes -= size;
+        mNumBlocks--;
+    }
+
+    void Heap::TrackAllocationSites()
+    {
+        if (mSites == NULL)
+        {
+            mSites = new Dictionary<const Object *, AllocationSite>();
+        }
+    }
+
+    bool Heap::FindSite(const Object * object, AllocationSite * site) const
+    {
+        if (mSites == NULL) return false;
+
+        return mSites->Find(object, site);
+    }
+
+    Fiber * Heap::SetRunningFiber(Fiber * fiber)
+    {
+        Fiber * previous = mRunningFiber;
+        mRunningFiber = fiber;
+        return previous;
+    }
+
+    void Heap::RecordSite(const Object * object)
+    {
+        if (mRunningFiber == NULL) return;
+
+        AllocationSite site;
+        if (mRunningFiber->GetCurrentSite(&site)) mSites->Insert(object, site);
+    }
+
+    void Heap::ReleaseBuffered(Object * object)
+    {
+        object->mColor = COLOR_BLACK;
+        object->ReleaseReferences();
+    }
+
+    void Heap::UpdateNextCheck()
+    {
+        // Once the heap has been checked, don't do it again until it has
+        // doubled, so that a big heap that is all in use isn't collected on
+        // every call. The hard limit can't be put off, though.
+        size_t next = static_cast<size_t>(-1);
+
+        if (mSoftLimit > 0)
+        {
+            next = mLiveBytes * 2;
+            if (next < mSoftLimit) next = mSoftLimit;
+        }
+
+        if ((mHardLimit > 0) && (next > mHardLimit)) next = mHardLimit;
+
+        mNextCheck = next;
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Array.h"
+#include "Block.h"
+#include "Dictionary.h"
+#include "Macros.h"
+#include "Object.h"
+#include "Ref.h"
+
+namespace Finch
+{
+    class Fiber;
+    
+    // Where an object was created: the compiled block that was running and
+    // the index of the instruction in it.
+    struct AllocationSite
+    {
+        AllocationSite()
+        :   block(),
+            ip(0)
+        {}
+        
+        Ref<Block> block;
+        int        ip;
+    };
+    
+    // Keeps track of how much memory the objects and compiled blocks in one
+    // interpreter are using, and keeps it under the limits the host sets.
+    //
+    // Every object points to the heap it was created in, so that it's taken
+    // back out of the right heap when it's freed. Objects that own memory
+    // that can grow, like arrays, report it as they grow.
+    //
+    // The heap also keeps the buffer of objects that may be the only way
+    // into a garbage cycle, and runs the CycleCollector on them. Each
+    // interpreter collects its own objects, on its own schedule.
+    //
+    // There are two limits. Going over the soft limit runs the
+    // CycleCollector to try to free enough. Going over the hard limit does
+    // too, and if it's still over after that, the fiber that was running is
+    // stopped with an error (see Fiber::CallBlock()). Neither is checked on
+    // every allocation, only when a fiber calls a block, so the heap can go
+    // past the hard limit by however much was allocated since the last call.
+    //
+    // The heap can also remember where each object was created, so that a
+    // HeapDump can say which code is responsible for what is using memory.
+    // That costs a table entry per object, so it's off unless turned on.
+    class Heap
+    {
+    public:
+        Heap();
+
+        ~Heap();
+
+        // Sets the limits, in bytes. A limit of zero means there is none,
+        // which is the default.
+        void SetLimits(size_t softLimit, size_t hardLimit);
+
+        size_t SoftLimit() const { return mSoftLimit; }
+        size_t HardLimit() const { return mHardLimit; }
+
+        // Gets the total number of bytes used by live objects and compiled
+        // blocks.
+        size_t LiveBytes() const { return mLiveBytes; }
+
+        // Gets the number of bytes used by the live objects of the given kind.
+        size_t LiveBytes(ObjectKind kind) const { return mKindBytes[kind]; }
+
+        // Gets the number of live objects of the given kind.
+        int LiveObjects(ObjectKind kind) const { return mKindCounts[kind]; }
+
+        // Gets the number of bytes used by compiled blocks.
+        size_t BlockBytes() const { return mBlockBytes; }
+
+        // Gets the number of compiled blocks.
+        int NumBlocks() const { return mNumBlocks; }
+
+        // Gets whether the heap has grown enough since it was last checked
+        // that it's worth calling Check().
+        bool NeedsCheck() const { return mLiveBytes > mNextCheck; }
+
+        // Collects garbage cycles to get back under the limits. Returns false
+        // if the heap is still over the hard limit after that.
+        bool Check();
+
+        // Called when a reference to an object in this heap that may be part
+        // of a cycle has been released but others remain.
+        void PossibleRoot(Object * object)
+        {
+            object->mColor = COLOR_PURPLE;
+
+            if (!object->mIsBuffered)
+            {
+                object->mIsBuffered = true;
+                mRoots.Add(object);
+            }
+        }
+
+        // Called when the last reference to an object that is in the root
+        // buffer has been released. It lets go of everything it refers to,
+        // but can't be freed until the next collection removes it from the
+        // buffer.
+        void ReleaseRoot(Object * object)
+        {
+            // Objects are often released soon after they're buffered, so
+            // look for it among the last few roots. If it's there, it can be
+            // removed and freed right away. The order of the roots doesn't
+            // matter, so the last one takes its place.
+            int end = mRoots.Count() - RECENT_ROOTS;
+            if (end < 0) end = 0;
+
+            for (int i = mRoots.Count() - 1; i >= end; i--)
+            {
+                if (mRoots[i] == object)
+                {
+                    mRoots[i] = mRoots[-1];
+                    mRoots.RemoveAt(-1);
+                    delete object;
+                    return;
+                }
+            }
+
+            ReleaseBuffered(object);
+        }
+
+        // Gets whether enough candidate roots have built up that it's worth
+        // running a collection.
+        bool ShouldCollect() const
+        {
+            return mRoots.Count() >= mCollectThreshold;
+        }
+
+        // Finds and frees all garbage cycles among the objects in this heap.
+        // Returns the number of bytes used by the objects in them.
+        int Collect();
+
+        // Gets whether allocating the given number of bytes would put the
+        // heap over the hard limit. Used to turn down a single allocation
+        // that is too big before it's made.
+        bool CanAllocate(size_t bytes) const;
+
+        // Gets the error message a fiber reports when it's stopped for going
+        // over the hard limit.
+        String LimitError() const;
+
+        // Starts counting a newly created object. Returns it.
+        template <class T>
+        T * Add(T * object)
+        {
+            // The class is known here, so skip the virtual call.
+            Count(object->Kind(), object->T::GetSize());
+            object->mHeap = this;
+            
+            if (mSites != NULL) RecordSite(object);
+            return object;
+        }
+
+        // Stops counting an object that is about to be freed.
+        void Remove(Object * object);
+
+        // Called when an object of the given kind has grown or shrunk.
+        void Resize(ObjectKind kind, int oldSize, int newSize);
+
+        // Starts and stops counting a compiled block of the given size.
+        void AddBlock(int size);
+        void RemoveBlock(int size);
+
+        // Starts remembering where objects are created. Only objects created
+        // after this is called have a site.
+        void TrackAllocationSites();
+
+        // Gets whether allocation sites are being remembered.
+        bool IsTrackingAllocationSites() const { return mSites != NULL; }
+
+        // Looks up where the given object was created. Returns false if it
+        // isn't known, because sites weren't being tracked when it was
+        // created, or it wasn't created by a fiber.
+        bool FindSite(const Object * object, AllocationSite * site) const;
+
+        // Sets the fiber whose current instruction is the site of new
+        // objects. Returns the one that was set before, so that it can be
+        // put back when this one stops running.
+        Fiber * SetRunningFiber(Fiber * fiber);
+
+    private:
+        static const int NUM_KINDS = OBJECT_STRING + 1;
+
+        // How many roots need to be buffered before a collection is run,
+        // at least.
+        static const int MIN_COLLECT_THRESHOLD = 10000;
+
+        // How many of the most recently buffered roots ReleaseRoot() looks
+        // through.
+        static const int RECENT_ROOTS = 8;
+
+        // Adds a new object of the given kind and size to the totals.
+        void Count(ObjectKind kind, int size)
+        {
+            mLiveBytes += size;
+            mKindBytes[kind] += size;
+            mKindCounts[kind]++;
+        }
+
+        // Remembers where a newly created object is being created.
+        void RecordSite(const Object * object);
+
+        // Works out how big the heap can get before it needs checking again.
+        void UpdateNextCheck();
+
+        // Releases everything a buffered object that is no longer referenced
+        // refers to. The object itself is freed by the next collection.
+        void ReleaseBuffered(Object * object);
+
+        size_t mSoftLimit;
+        size_t mHardLimit;
+        size_t mNextCheck;
+
+        size_t mLiveBytes;
+        size_t mKindBytes[NUM_KINDS];
+        int    mKindCounts[NUM_KINDS];
+        size_t mBlockBytes;
+        int    mNumBlocks;
+
+        // The objects that may be the only way into a garbage cycle.
+        Array<Object *> mRoots;
+        int             mCollectThreshold;
+
+        // The allocation site of each object created since sites started
+        // being tracked, or NULL if they aren't.
+        Dictionary<const Object *, AllocationSite> * mSites;
+        Fiber * mRunningFiber;
+
+        NO_COPY(Heap);
+    };
+}
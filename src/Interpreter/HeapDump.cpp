@@ -0,0 +1,523 @@
+#include <cmath>
+
+#include "HeapDump.h"
+#include "BlockObject.h"
+#include "DynamicObject.h"
+#include "Heap.h"
+#include "Interpreter.h"
+#include "NumberFormat.h"
+#include "NumberObject.h"
+#include "Stack.h"
+#include "StringObject.h"
+
+namespace Finch
+{
+    const int HeapDump::ROOT;
+
+    void HeapDump::Write(Interpreter & interpreter, ostream & out)
+    {
+        HeapDump dump(interpreter);
+
+        dump.FindObjects();
+        dump.FindDominators();
+        dump.FindRetainedSizes();
+        dump.FindSites();
+        dump.WriteJson(out);
+    }
+
+    HeapDump::HeapDump(Interpreter & interpreter)
+    :   mInterpreter(interpreter)
+    {
+        // Block ids start at one, like object ids.
+        mBlocks.Add(NULL);
+        mBlockOffsets.Add(0);
+    }
+
+    void HeapDump::FindObjects()
+    {
+        mObjects.Add(NULL);
+
+        mFirstEdge.Add(0);
+        for (int i = 0; i < mInterpreter.NumGlobals(); i++)
+        {
+            const Value & global = mInterpreter.GetGlobal(i);
+            if (global.IsNull()) continue;
+
+            int node = NodeFor(global.mObj);
+            mGlobals.Add(i);
+            mGlobalNodes.Add(node);
+            mEdges.Add(node);
+        }
+
+        // Visiting an object's references adds the new objects it refers to
+        // to the end, so this goes until there are no more.
+        for (int node = 1; node < mObjects.Count(); node++)
+        {
+            mFirstEdge.Add(mEdges.Count());
+
+            const Object * object = mObjects[node];
+            object->VisitReferences(*this);
+
+            if (object->Kind() == OBJECT_BLOCK)
+            {
+                static_cast<const BlockObject *>(object)->
+                    VisitSharedReferences(*this);
+            }
+        }
+
+        mFirstEdge.Add(mEdges.Count());
+    }
+
+    void HeapDump::FindDominators()
+    {
+        int count = mObjects.Count();
+
+        // Number the nodes in postorder with an explicit depth-first walk,
+        // since the graph can be far deeper than the native stack.
+        mOrder = Array<int>(count, -1);
+        Array<bool> visited(count, false);
+        Stack<int> nodes;
+        Stack<int> edges;
+
+        visited[ROOT] = true;
+        nodes.Push(ROOT);
+        edges.Push(mFirstEdge[ROOT]);
+
+        while (!nodes.IsEmpty())
+        {
+            int node = nodes.Peek();
+            int & edge = edges.Peek();
+
+            if (edge < mFirstEdge[node + 1])
+            {
+                int next = mEdges[edge++];
+                if (!visited[next])
+                {
+                    visited[next] = true;
+                    nodes.Push(next);
+                    edges.Push(mFirstEdge[next]);
+                }
+            }
+            else
+            {
+                mOrder[node] = mPostorder.Count();
+                mPostorder.Add(node);
+                nodes.Pop();
+                edges.Pop();
+            }
+        }
+
+        // Turn the references around to get each node's predecessors, laid
+        // out the same way.
+        Array<int> firstPred(count + 1, 0);
+        for (int i = 0; i < mEdges.Count(); i++) firstPred[mEdges[i] + 1]++;
+        for (int i = 0; i < count; i++) firstPred[i + 1] += firstPred[i];
+
+        Array<int> preds(mEdges.Count(), 0);
+        Array<int> filled(count, 0);
+        for (int node = 0; node < count; node++)
+        {
+            for (int i = mFirstEdge[node]; i < mFirstEdge[node + 1]; i++)
+            {
+                int target = mEdges[i];
+                preds[firstPred[target] + filled[target]++] = node;
+            }
+        }
+
+        // Every node starts out undominated except for the root. Going
+        // through them in reverse postorder, each one's dominator is the
+        // closest common dominator of the predecessors that have one so far.
+        // Repeat until nothing changes, which for most graphs is twice.
+        mDominators = Array<int>(count, -1);
+        mDominators[ROOT] = ROOT;
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            // The root is last in postorder, so skip it.
+            for (int i = mPostorder.Count() - 2; i >= 0; i--)
+            {
+                int node = mPostorder[i];
+
+                int dominator = -1;
+                for (int j = firstPred[node]; j < firstPred[node + 1]; j++)
+                {
+                    int pred = preds[j];
+                    if (mDominators[pred] == -1) continue;
+
+                    dominator = (dominator == -1) ? pred :
+                                Intersect(pred, dominator);
+                }
+
+                if (mDominators[node] != dominator)
+                {
+                    mDominators[node] = dominator;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    void HeapDump::FindRetainedSizes()
+    {
+        mRetained = Array<size_t>(mObjects.Count(), 0);
+        for (int node = 1; node < mObjects.Count(); node++)
+        {
+            mRetained[node] = static_cast<size_t>(mObjects[node]->GetSize());
+        }
+
+        // A node's dominator is always above it in the depth-first walk, so
+        // it comes later in postorder, after everything it dominates has
+        // been added to it.
+        for (int i = 0; i < mPostorder.Count() - 1; i++)
+        {
+            int node = mPostorder[i];
+            mRetained[mDominators[node]] += mRetained[node];
+        }
+    }
+
+    void HeapDump::FindSites()
+    {
+        Heap & heap = mInterpreter.GetHeap();
+
+        mNodeBlocks = Array<int>(mObjects.Count(), -1);
+        mNodeIps = Array<int>(mObjects.Count(), -1);
+
+        for (int node = 1; node < mObjects.Count(); node++)
+        {
+            const Object * object = mObjects[node];
+
+            if (object->Kind() == OBJECT_BLOCK)
+            {
+                BlockIdFor(&*static_cast<const BlockObject *>(object)->
+                    GetCompiledBlock());
+            }
+
+            AllocationSite site;
+            if (!heap.FindSite(object, &site)) continue;
+
+            int id = BlockIdFor(&*site.block);
+            mNodeBlocks[node] = id;
+            mNodeIps[node] = site.ip;
+
+            int index = mBlockOffsets[id] + site.ip;
+            mSiteObjects[index]++;
+            mSiteBytes[index] += static_cast<size_t>(object->GetSize());
+        }
+    }
+
+    void HeapDump::WriteJson(ostream & out)
+    {
+        Heap & heap = mInterpreter.GetHeap();
+
+        out << "{\n";
+        out << "\"live-bytes\": " << heap.LiveBytes() << ",\n";
+        out << "\"block-bytes\": " << heap.BlockBytes() << ",\n";
+        out << "\"reachable-bytes\": " << mRetained[ROOT] << ",\n";
+
+        out << "\"globals\": [";
+        for (int i = 0; i < mGlobals.Count(); i++)
+        {
+            if (i > 0) out << ",";
+
+            int node = mGlobalNodes[i];
+            out << "\n{\"name\": ";
+            WriteString(out, mInterpreter.FindGlobalName(mGlobals[i]));
+            out << ", \"object\": " << node
+                << ", \"retained\": " << mRetained[node] << "}";
+        }
+        out << "\n],\n";
+
+        out << "\"objects\": [";
+        for (int node = 1; node < mObjects.Count(); node++)
+        {
+            if (node > 1) out << ",";
+            out << "\n";
+            WriteObject(out, node);
+        }
+        out << "\n],\n";
+
+        out << "\"blocks\": [";
+        for (int id = 1; id < mBlocks.Count(); id++)
+        {
+            if (id > 1) out << ",";
+            out << "\n";
+            WriteBlock(out, id);
+        }
+        out << "\n],\n";
+
+        out << "\"sites\": [";
+        bool first = true;
+        for (int id = 1; id < mBlocks.Count(); id++)
+        {
+            int numInstructions = mBlocks[id]->Code().Count();
+            for (int ip = 0; ip < numInstructions; ip++)
+            {
+                int index = mBlockOffsets[id] + ip;
+                if (mSiteObjects[index] == 0) continue;
+
+                if (!first) out << ",";
+                first = false;
+
+                out << "\n{\"block\": " << id << ", \"ip\": " << ip;
+
+                String message = MessageAt(*mBlocks[id], ip);
+                if (message.Length() > 0)
+                {
+                    out << ", \"message\": ";
+                    WriteString(out, message);
+                }
+
+                out << ", \"objects\": " << mSiteObjects[index]
+                    << ", \"bytes\": " << mSiteBytes[index] << "}";
+            }
+        }
+        out << "\n]\n";
+
+        out << "}\n";
+    }
+
+    void HeapDump::WriteObject(ostream & out, int node)
+    {
+        const Object * object = mObjects[node];
+
+        out << "{\"id\": " << node
+            << ", \"kind\": \"" << KindName(object->Kind()) << "\""
+            << ", \"size\": " << object->GetSize()
+            << ", \"retained\": " << mRetained[node];
+
+        const Value & parent = object->Parent();
+        if (!parent.IsNull())
+        {
+            out << ", \"parent\": " << NodeFor(parent.mObj);
+        }
+
+        switch (object->Kind())
+        {
+            case OBJECT_BLOCK:
+            {
+                const BlockObject * block =
+                    static_cast<const BlockObject *>(object);
+                out << ", \"code\": " << BlockIdFor(&*block->GetCompiledBlock());
+                break;
+            }
+
+            case OBJECT_DYNAMIC:
+            {
+                const DynamicObject * dynamic =
+                    static_cast<const DynamicObject *>(object);
+
+                if (dynamic->Name() != NULL)
+                {
+                    out << ", \"name\": ";
+                    WriteString(out, *dynamic->Name());
+                }
+
+                out << ", \"fields\": {";
+                bool first = true;
+                for (IdTable<Value>::Iterator it(dynamic->Fields());
+                     !it.IsDone(); it.Next())
+                {
+                    if (!first) out << ", ";
+                    first = false;
+
+                    WriteString(out, mInterpreter.FindString(it.Key()));
+                    out << ": ";
+
+                    if (it.Value().IsNull())
+                    {
+                        out << "null";
+                    }
+                    else
+                    {
+                        out << NodeFor(it.Value().mObj);
+                    }
+                }
+                out << "}";
+
+                out << ", \"methods\": " << dynamic->NumMethods();
+                break;
+            }
+
+            case OBJECT_NUMBER:
+                out << ", \"value\": ";
+                WriteNumber(out,
+                    static_cast<const NumberObject *>(object)->AsNumber());
+                break;
+
+            case OBJECT_STRING:
+            {
+                String text = static_cast<const StringObject *>(object)->
+                    AsString();
+
+                out << ", \"length\": " << text.Length() << ", \"value\": ";
+                if (text.Length() > MAX_STRING_LENGTH)
+                {
+                    text = text.Substring(0, MAX_STRING_LENGTH);
+                }
+                WriteString(out, text);
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        out << ", \"references\": [";
+        for (int i = mFirstEdge[node]; i < mFirstEdge[node + 1]; i++)
+        {
+            if (i > mFirstEdge[node]) out << ", ";
+            out << mEdges[i];
+        }
+        out << "]";
+
+        if (mNodeBlocks[node] != -1)
+        {
+            out << ", \"site\": {\"block\": " << mNodeBlocks[node]
+                << ", \"ip\": " << mNodeIps[node] << "}";
+        }
+
+        out << "}";
+    }
+
+    void HeapDump::WriteBlock(ostream & out, int id)
+    {
+        const Block & block = *mBlocks[id];
+
+        out << "{\"id\": " << id
+            << ", \"size\": " << block.GetSize()
+            << ", \"instructions\": " << block.Code().Count()
+            << ", \"method\": "
+            << ((block.MethodId() == Block::BLOCK_METHOD_ID) ? "false" : "true")
+            << ", \"params\": [";
+
+        for (int i = 0; i < block.Params().Count(); i++)
+        {
+            if (i > 0) out << ", ";
+            WriteString(out, block.Params()[i]);
+        }
+
+        out << "]}";
+    }
+
+    int HeapDump::NodeFor(const Object * object)
+    {
+        int node;
+        if (mNodes.Find(object, &node)) return node;
+
+        node = mObjects.Count();
+        mObjects.Add(object);
+        mNodes.Insert(object, node);
+        return node;
+    }
+
+    int HeapDump::BlockIdFor(const Block * block)
+    {
+        int id;
+        if (mBlockIds.Find(block, &id)) return id;
+
+        id = mBlocks.Count();
+        mBlocks.Add(block);
+        mBlockIds.Insert(block, id);
+
+        // Make room to count the objects created by each instruction.
+        int numInstructions = block->Code().Count();
+        mBlockOffsets.Add(mSiteObjects.Count());
+        for (int i = 0; i < numInstructions; i++)
+        {
+            mSiteObjects.Add(0);
+            mSiteBytes.Add(0);
+        }
+
+        return id;
+    }
+
+    String HeapDump::MessageAt(const Block & block, int ip)
+    {
+        Instruction instruction = block.Code()[ip];
+        OpCode op = DECODE_OP(instruction);
+
+        if ((op < OP_MESSAGE_0) || (op > OP_TAIL_MESSAGE_10)) return "";
+
+        return mInterpreter.FindString(DECODE_A(instruction));
+    }
+
+    void HeapDump::Visit(const Value & value)
+    {
+        if (value.IsNull()) return;
+
+        mEdges.Add(NodeFor(value.mObj));
+    }
+
+    int HeapDump::Intersect(int a, int b) const
+    {
+        while (a != b)
+        {
+            while (mOrder[a] < mOrder[b]) a = mDominators[a];
+            while (mOrder[b] < mOrder[a]) b = mDominators[b];
+        }
+
+        return a;
+    }
+
+    const char * HeapDump::KindName(ObjectKind kind)
+    {
+        switch (kind)
+        {
+            case OBJECT_ARRAY:          return "array";
+            case OBJECT_BLOCK:          return "block";
+            case OBJECT_DYNAMIC:        return "object";
+            case OBJECT_FIBER:          return "fiber";
+            case OBJECT_MAP:            return "map";
+            case OBJECT_NUMBER:         return "number";
+            case OBJECT_NUMBER_ARRAY:   return "number-array";
+            case OBJECT_STRING:         return "string";
+        }
+
+        ASSERT(false, "Unknown object kind.");
+        return "";
+    }
+
+    void HeapDump::WriteString(ostream & out, const String & text)
+    {
+        static const char * hex = "0123456789abcdef";
+
+        out << "\"";
+        for (int i = 0; i < text.Length(); i++)
+        {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            switch (c)
+            {
+                case '"':  out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\r': out << "\\r"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (c < 0x20)
+                    {
+                        out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+                    }
+                    else
+                    {
+                        out << static_cast<char>(c);
+                    }
+            }
+        }
+        out << "\"";
+    }
+
+    void HeapDump::WriteNumber(ostream & out, double value)
+    {
+        // JSON has no way to write infinity or NaN.
+        if (!std::isfinite(value))
+        {
+            out << "null";
+            return;
+        }
+
+        NumberFormat::Write(out, value);
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+
+#include "Array.h"
+#include "Block.h"
+#include "Dictionary.h"
+#include "Macros.h"
+#include "Object.h"
+
+namespace Finch
+{
+    using std::ostream;
+
+    class Interpreter;
+
+    // Writes out a snapshot of the objects in an interpreter as JSON, to
+    // find out what is using the memory in one that has grown too big. It
+    // starts with the heap's totals, followed by four parts:
+    //
+    // - "objects": every object reachable from the globals, with its kind,
+    //   size in bytes, parent, outgoing references (including its parent),
+    //   and retained size: how many bytes would be freed if it was. Dynamic
+    //   objects also list their fields and how many methods they have.
+    // - "globals": the object each global refers to and its retained size.
+    // - "blocks": the compiled blocks that objects were created from or run.
+    // - "sites": if the heap is tracking allocation sites, the number of
+    //   objects and bytes created by each instruction, counting only the
+    //   objects in the dump.
+    //
+    // Objects refer to each other and to blocks by id. The retained sizes
+    // come from the dominator tree of the object graph: an object dominates
+    // another if every path to it from the globals goes through it, so
+    // it retains itself and everything it dominates. The dominators are
+    // found with the iterative algorithm from Cooper, Harvey and Kennedy's
+    // "A Simple, Fast Dominance Algorithm".
+    //
+    // Compiled blocks aren't objects, so the objects in their constants are
+    // treated as referenced by every block object created from them.
+    class HeapDump : public IReferenceVisitor
+    {
+    public:
+        // Dumps the heap of the given interpreter to the stream.
+        static void Write(Interpreter & interpreter, ostream & out);
+
+    private:
+        // The node standing for the globals. Every global's object is a
+        // reference from it.
+        static const int ROOT = 0;
+
+        // How many characters of a string's value are written out.
+        static const int MAX_STRING_LENGTH = 100;
+
+        HeapDump(Interpreter & interpreter);
+
+        // Walks the graph breadth-first from the globals, giving each object
+        // a node and recording its references.
+        void FindObjects();
+
+        // Finds the immediate dominator of each node.
+        void FindDominators();
+
+        // Adds the size of each node to the retained sizes of its dominators.
+        void FindRetainedSizes();
+
+        // Gives ids to the compiled blocks of the block objects, and looks up
+        // the allocation site of each node and totals them by site.
+        void FindSites();
+
+        void WriteJson(ostream & out);
+        void WriteObject(ostream & out, int node);
+        void WriteBlock(ostream & out, int id);
+
+        // Gets the node for the given object, adding it if it's new.
+        int NodeFor(const Object * object);
+
+        // Gets the id for the given compiled block, adding it if it's new.
+        int BlockIdFor(const Block * block);
+
+        // Gets the name of the message the given instruction sends, or an
+        // empty string if it doesn't send one.
+        String MessageAt(const Block & block, int ip);
+
+        // Adds a reference from the node being walked.
+        virtual void Visit(const Value & value);
+
+        // Walks up the dominator tree from two nodes to the first one that
+        // dominates both.
+        int Intersect(int a, int b) const;
+
+        static const char * KindName(ObjectKind kind);
+        static void WriteString(ostream & out, const String & text);
+        static void WriteNumber(ostream & out, double value);
+
+        Interpreter & mInterpreter;
+
+        // The object for each node, indexed by node. The root's is NULL.
+        Array<const Object *> mObjects;
+        Dictionary<const Object *, int> mNodes;
+
+        // The globals that refer to objects, and their nodes.
+        Array<int> mGlobals;
+        Array<int> mGlobalNodes;
+
+        // The references out of every node, one after another. The ones
+        // from a node start at mFirstEdge[node] and end where the next
+        // node's start.
+        Array<int> mFirstEdge;
+        Array<int> mEdges;
+
+        // The nodes in the order a depth-first walk finished with them, and
+        // the index of each node in that order. The root comes last.
+        Array<int> mPostorder;
+        Array<int> mOrder;
+
+        // The immediate dominator of each node. The root is its own.
+        Array<int> mDominators;
+        Array<size_t> mRetained;
+
+        // The compiled blocks in the dump, indexed by id. The counts for the
+        // sites in each block start at its offset into mSiteObjects and
+        // mSiteBytes, one for each instruction.
+        Array<const Block *> mBlocks;
+        Dictionary<const Block *, int> mBlockIds;
+        Array<int> mBlockOffsets;
+        Array<int> mSiteObjects;
+        Array<size_t> mSiteBytes;
+
+        // The allocation site of each node, as a block id and instruction,
+        // or -1 if it isn't known.
+        Array<int> mNodeBlocks;
+        Array<int> mNodeIps;
+
+        NO_COPY(HeapDump);
+    };
+}
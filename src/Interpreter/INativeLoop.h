@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Macros.h"
+#include "Object.h"
+
+namespace Finch
+{
+    class Fiber;
+    
+    // Interface for a primitive that calls blocks repeatedly, like Arrays
+    // each:. A primitive can't run a block to completion itself since calling
+    // one just pushes a callframe. Instead, the loop gets a callframe of its
+    // own, and each time a block it called returns, the fiber hands the
+    // result back to the loop so it can take its next step.
+    class INativeLoop
+    {
+    public:
+        virtual ~INativeLoop() {}
+        
+        // Advances the loop. The result is what the block it last called
+        // returned, or a null Value on the first step. Either calls the next
+        // block using Fiber::CallLoopBlock() and returns a null Value, or
+        // returns the final result of the loop.
+        virtual Value Step(Fiber & fiber, const Value & result) = 0;
+    };
+}
+
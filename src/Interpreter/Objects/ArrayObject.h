@@ -16,21 +16,56 @@ namespace Finch
     {
     public:
         ArrayObject(const Value & parent, int length)
-        :   Object(parent),
+        :   Object(parent, OBJECT_ARRAY),
             mElements(length)
         {
         }
         
+        // Gets the elements. Add to them with Add() instead of through
+        // this, so that the heap sees the array grow.
         Array<Value> & Elements() { return mElements; }
         
+        // Adds an element to the end of the array.
+        void Add(const Value & element)
+        {
+            int capacity = mElements.Capacity();
+            mElements.Add(element);
+            
+            if (mElements.Capacity() != capacity)
+            {
+                Resized(capacity * static_cast<int>(sizeof(Value)),
+                        mElements.Capacity() * static_cast<int>(sizeof(Value)));
+            }
+        }
+        
         virtual void Trace(ostream & stream) const
         {
             stream << AsString();
         }
         
-        virtual ArrayObject * AsArray() { return this; }
+        virtual int GetSize() const
+        {
+            return static_cast<int>(sizeof(ArrayObject) +
+                                    mElements.Capacity() * sizeof(Value));
+        }
         
-        virtual String AsString() const
+        virtual void VisitReferences(IReferenceVisitor & visitor) const
+        {
+            Object::VisitReferences(visitor);
+            
+            for (int i = 0; i < mElements.Count(); i++)
+            {
+                visitor.Visit(mElements[i]);
+            }
+        }
+        
+        virtual void ReleaseReferences()
+        {
+            Object::ReleaseReferences();
+            mElements.Clear();
+        }
+        
+        String AsString() const
         {
             String text = "#[";
             
@@ -47,5 +82,11 @@ namespace Finch
     private:
         Array<Value> mElements;
     };
+    
+    inline ArrayObject * Value::AsArray() const
+    {
+        if (Kind() != OBJECT_ARRAY) return NULL;
+        return static_cast<ArrayObject *>(mObj);
+    }
 }
 
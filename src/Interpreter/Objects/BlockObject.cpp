@@ -13,6 +13,11 @@ namespace Finch
         return mBlock->GetBlock(index);
     }
     
+    const ObjectTemplate & BlockObject::GetTemplate(int index) const
+    {
+        return mBlock->GetTemplate(index);
+    }
+    
     // Gets the compiled bytecode for the block.
     const Array<Instruction> & BlockObject::Code() const
     {
@@ -28,4 +33,61 @@ namespace Finch
     {
         return mUpvalues[index];
     }
+    
+    int BlockObject::GetSize() const
+    {
+        // The compiled Block is shared by every object created from it, so
+        // it isn't counted.
+        return static_cast<int>(sizeof(BlockObject) +
+                                mUpvalues.Capacity() * sizeof(Ref<Upvalue>) +
+                                mCaptures.Capacity() * sizeof(Value));
+    }
+    
+    void BlockObject::VisitReferences(IReferenceVisitor & visitor) const
+    {
+        Object::VisitReferences(visitor);
+        
+        visitor.Visit(mSelf);
+        
+        for (int i = 0; i < mCaptures.Count(); i++)
+        {
+            visitor.Visit(mCaptures[i]);
+        }
+        
+        // An upvalue that is still open refers to a register, and one shared
+        // with other blocks can't be attributed to any one of them, so only
+        // closed upvalues this block owns are followed.
+        for (int i = 0; i < mUpvalues.Count(); i++)
+        {
+            const Ref<Upvalue> & upvalue = mUpvalues[i];
+            if (upvalue.IsUnique() && !upvalue->IsOpen())
+            {
+                visitor.Visit(upvalue->ClosedValue());
+            }
+        }
+    }
+    
+    void BlockObject::VisitSharedReferences(IReferenceVisitor & visitor) const
+    {
+        for (int i = 0; i < mUpvalues.Count(); i++)
+        {
+            const Ref<Upvalue> & upvalue = mUpvalues[i];
+            if (!upvalue.IsUnique() && !upvalue->IsOpen())
+            {
+                visitor.Visit(upvalue->ClosedValue());
+            }
+        }
+        
+        mBlock->VisitConstants(visitor);
+    }
+    
+    void BlockObject::ReleaseReferences()
+    {
+        Object::ReleaseReferences();
+        
+        mBlock.Clear();
+        mSelf.Clear();
+        mUpvalues.Clear();
+        mCaptures.Clear();
+    }
 }
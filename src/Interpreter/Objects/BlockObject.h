@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <stdint.h>
 
 #include "Block.h"
 #include "Expr.h"
@@ -22,10 +23,13 @@ namespace Finch
     {
     public:
         BlockObject(const Value & parent, Ref<Block> block, const Value & self)
-        :   Object(parent),
+        :   Object(parent, OBJECT_BLOCK),
             mBlock(block),
             mSelf(self),
-            mUpvalues(block->NumUpvalues())
+            mUpvalues(block->NumUpvalues()),
+            mCaptures(block->NumCaptures()),
+            mHomeFrame(-1),
+            mHomeFrameId(0)
         {}
         
         bool IsMethod() const { return !mSelf.IsNull(); }
@@ -34,12 +38,19 @@ namespace Finch
         // block.
         const Value & Self() const { return mSelf; }
 
+        // Gets whether this object was created from the given block.
+        bool IsFrom(const Block & block) const { return &*mBlock == &block; }
+        
         int NumRegisters() const { return mBlock->NumRegisters(); }
         int NumParams() const { return mBlock->Params().Count(); }
         int MethodId() const { return mBlock->MethodId(); }
         
+        // Gets the compiled block this object was created from.
+        const Ref<Block> & GetCompiledBlock() const { return mBlock; }
+        
         const Value & GetConstant(int index) const;
         const Ref<Block> GetBlock(int index) const;
+        const ObjectTemplate & GetTemplate(int index) const;
         
         // Gets the compiled bytecode for the block.
         const Array<Instruction> & Code() const;
@@ -47,17 +58,51 @@ namespace Finch
         void AddUpvalue(Ref<Upvalue> upvalue);
         Ref<Upvalue> GetUpvalue(int index) const;
         
-        virtual BlockObject * AsBlock() { return this; }
+        // Captured variables that never change are copied straight into the
+        // block instead of going through an Upvalue.
+        void AddCapture(const Value & value) { mCaptures.Add(value); }
+        const Value & GetCapture(int index) const { return mCaptures[index]; }
+        
+        // The call frame for the method this block was created in, as its
+        // index from the bottom of the callstack and the frame's unique ID.
+        // Only set for blocks that return from their method.
+        int HomeFrame() const { return mHomeFrame; }
+        uint64_t HomeFrameId() const { return mHomeFrameId; }
+        
+        void SetHomeFrame(int frame, uint64_t id)
+        {
+            mHomeFrame = frame;
+            mHomeFrameId = id;
+        }
         
         virtual void Trace(ostream & stream) const
         {
             stream << "block";
         }
         
+        virtual int GetSize() const;
+        virtual void VisitReferences(IReferenceVisitor & visitor) const;
+        virtual void ReleaseReferences();
+        
+        // Passes the values that VisitReferences() leaves out to the
+        // visitor: closed upvalues shared with other blocks, and the
+        // constants in the compiled block. Used to find everything a block
+        // keeps alive, not just what it owns.
+        void VisitSharedReferences(IReferenceVisitor & visitor) const;
+        
     private:
         Ref<Block>              mBlock;
         Value                   mSelf;
         Array<Ref<Upvalue> >    mUpvalues;
+        Array<Value>            mCaptures;
+        int                     mHomeFrame;
+        uint64_t                mHomeFrameId;
     };
+    
+    inline BlockObject * Value::AsBlock() const
+    {
+        if (Kind() != OBJECT_BLOCK) return NULL;
+        return static_cast<BlockObject *>(mObj);
+    }
 }
 
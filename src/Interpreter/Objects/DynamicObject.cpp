@@ -1,36 +1,96 @@
 #include "DynamicObject.h"
 #include "BlockObject.h"
 #include "Fiber.h"
+#include "ObjectTemplate.h"
 
 namespace Finch
 {
     using std::ostream;
     
+    DynamicObject::DynamicObject(const Value & parent,
+                                 const ObjectTemplate & objectTemplate)
+    :   Object(parent, OBJECT_DYNAMIC),
+        mName(NULL),
+        mMethods(NULL)
+    {
+        mFields.Reserve(objectTemplate.NumFields());
+        
+        if (objectTemplate.Methods().Count() > 0)
+        {
+            mMethods = new IdTable<Method>();
+            mMethods->CopyFrom(objectTemplate.Methods());
+        }
+    }
+    
+    DynamicObject::~DynamicObject()
+    {
+        delete mName;
+        delete mMethods;
+    }
+    
     void DynamicObject::Trace(ostream & stream) const
     {
-        stream << mName;
+        stream << AsString();
     }
     
-    Value DynamicObject::FindMethod(StringId messageId)
+    int DynamicObject::GetSize() const
     {
-        Value method;
-        if (mMethods.Find(messageId, &method))
+        int size = static_cast<int>(sizeof(DynamicObject)) +
+                   mFields.AllocatedBytes();
+        
+        if (mName != NULL)
         {
-            return method;
+            size += static_cast<int>(sizeof(String)) + mName->Length();
         }
         
-        return Value();
+        if (mMethods != NULL)
+        {
+            size += static_cast<int>(sizeof(IdTable<Method>)) +
+                    mMethods->AllocatedBytes();
+        }
+        
+        return size;
     }
     
-    PrimitiveMethod DynamicObject::FindPrimitive(StringId messageId)
+    void DynamicObject::VisitReferences(IReferenceVisitor & visitor) const
     {
-        PrimitiveMethod primitive;
-        if (mPrimitives.Find(messageId, &primitive))
+        Object::VisitReferences(visitor);
+        
+        for (IdTable<Value>::Iterator it(mFields); !it.IsDone(); it.Next())
         {
-            return primitive;
+            visitor.Visit(it.Value());
         }
         
-        return NULL;
+        if (mMethods == NULL) return;
+        
+        for (IdTable<Method>::Iterator it(*mMethods); !it.IsDone(); it.Next())
+        {
+            visitor.Visit(it.Value().block);
+        }
+    }
+    
+    void DynamicObject::ReleaseReferences()
+    {
+        Object::ReleaseReferences();
+        
+        mFields.Clear();
+        
+        delete mMethods;
+        mMethods = NULL;
+    }
+    
+    String DynamicObject::AsString() const
+    {
+        if (mName == NULL) return "";
+        
+        return *mName;
+    }
+    
+    bool DynamicObject::FindMethod(StringId messageId, Method * method) const
+    {
+        if (mMethods == NULL) return false;
+        
+        return mMethods->Find(messageId, method);
     }
     
     Value DynamicObject::GetField(StringId name)
@@ -60,16 +120,41 @@ namespace Finch
     
     void DynamicObject::SetField(StringId name, const Value & value)
     {
+        int oldSize = mFields.AllocatedBytes();
         mFields.Insert(name, value);
+        
+        int newSize = mFields.AllocatedBytes();
+        if (newSize != oldSize) Resized(oldSize, newSize);
     }
         
     void DynamicObject::AddMethod(StringId messageId, const Value & method)
     {
-        mMethods.Insert(messageId, method);
+        int oldSize = GetSize();
+        
+        Method bound;
+        Methods().Find(messageId, &bound);
+        bound.block = method;
+        mMethods->Insert(messageId, bound);
+        
+        Resized(oldSize, GetSize());
     }
 
     void DynamicObject::AddPrimitive(StringId messageId, PrimitiveMethod method)
     {
-        mPrimitives.Insert(messageId, method);
+        int oldSize = GetSize();
+        
+        Method bound;
+        Methods().Find(messageId, &bound);
+        bound.primitive = method;
+        mMethods->Insert(messageId, bound);
+        
+        Resized(oldSize, GetSize());
+    }
+    
+    IdTable<DynamicObject::Method> & DynamicObject::Methods()
+    {
+        if (mMethods == NULL) mMethods = new IdTable<Method>();
+        
+        return *mMethods;
     }
 }
@@ -14,31 +14,58 @@ namespace Finch
     using std::ostream;
     
     class Interpreter;
+    class ObjectTemplate;
 
     // Object class for a "normal" full-featured object. Supports user-defined
     // fields and methods as well as primitive methods.
+    //
+    // Most objects are created by object literals and only have a few
+    // fields, so everything else is kept out of line: the method table is
+    // only allocated when the first method is added, and only named objects
+    // (the globals the interpreter creates) store a name.
     class DynamicObject : public Object
     {
     public:
+        // A method bound to a message name: a block written in Finch, a
+        // primitive, or both, in which case the block is used.
+        struct Method
+        {
+            Method() : primitive(NULL) {}
+            
+            Value           block;
+            PrimitiveMethod primitive;
+        };
+        
         DynamicObject(const Value & parent, String name)
-        :   Object(parent),
-            mName(name)
+        :   Object(parent, OBJECT_DYNAMIC),
+            mName(new String(name)),
+            mMethods(NULL)
         {
         }
         
         DynamicObject(const Value & parent)
-        :   Object(parent),
-            mName("object")
+        :   Object(parent, OBJECT_DYNAMIC),
+            mName(NULL),
+            mMethods(NULL)
         {
         }
         
+        // Creates a new object from an object literal's template.
+        DynamicObject(const Value & parent,
+                      const ObjectTemplate & objectTemplate);
+        
+        virtual ~DynamicObject();
+        
         virtual void Trace(ostream & stream) const;
+        virtual int GetSize() const;
+        virtual void VisitReferences(IReferenceVisitor & visitor) const;
+        virtual void ReleaseReferences();
         
-        virtual String AsString() const     { return mName; }
-        virtual DynamicObject * AsDynamic() { return this; }
+        String AsString() const;
         
-        Value FindMethod(StringId messageId);
-        PrimitiveMethod FindPrimitive(StringId messageId);
+        // Looks up the method bound to the given message on this object
+        // (not its parents). Returns false if there is none.
+        bool FindMethod(StringId messageId, Method * method) const;
 
         Value GetField(StringId name);
         void SetField(StringId name, const Value & value);
@@ -46,12 +73,32 @@ namespace Finch
         void AddMethod(StringId messageId, const Value & method);
         void AddPrimitive(StringId messageId, PrimitiveMethod method);
         
+        // Gets the name of this object, or NULL if it doesn't have one.
+        const String * Name() const { return mName; }
+        
+        const IdTable<Value> & Fields() const { return mFields; }
+        
+        // Gets the number of methods bound directly to this object.
+        int NumMethods() const
+        {
+            return (mMethods == NULL) ? 0 : mMethods->Count();
+        }
+        
     private:
+        // Gets the method table, creating it if needed.
+        IdTable<Method> & Methods();
         
-        String                      mName; //### bob: hack temp
-        IdTable<Value>              mFields;
-        IdTable<Value>              mMethods;
-        IdTable<PrimitiveMethod>    mPrimitives;
+        String *          mName;    //### bob: hack temp. NULL if unnamed.
+        IdTable<Value>    mFields;
+        IdTable<Method> * mMethods; // NULL until a method is added.
+        
+        NO_COPY(DynamicObject);
     };    
+    
+    inline DynamicObject * Value::AsDynamic() const
+    {
+        if (Kind() != OBJECT_DYNAMIC) return NULL;
+        return static_cast<DynamicObject *>(mObj);
+    }
 }
 
@@ -16,12 +16,10 @@ namespace Finch
     {
     public:
         FiberObject(const Value & parent, Interpreter & interpreter, const Value & block)
-        :   Object(parent),
+        :   Object(parent, OBJECT_FIBER),
             mFiber(interpreter, block)
         {}
         
-        virtual FiberObject * AsFiber() { return this; }
-        
         Fiber & GetFiber() { return mFiber; }
         
         virtual void Trace(ostream & stream) const
@@ -29,8 +27,32 @@ namespace Finch
             stream << "fiber";
         }
         
+        virtual int GetSize() const
+        {
+            // The fiber tells the heap itself when its registers grow.
+            return static_cast<int>(sizeof(FiberObject)) + mFiber.StackSize();
+        }
+        
+        virtual void VisitReferences(IReferenceVisitor & visitor) const
+        {
+            Object::VisitReferences(visitor);
+            mFiber.VisitReferences(visitor);
+        }
+        
+        virtual void ReleaseReferences()
+        {
+            Object::ReleaseReferences();
+            mFiber.ReleaseReferences();
+        }
+        
     private:
         Fiber mFiber;
     };
+    
+    inline FiberObject * Value::AsFiber() const
+    {
+        if (Kind() != OBJECT_FIBER) return NULL;
+        return static_cast<FiberObject *>(mObj);
+    }
 }
 
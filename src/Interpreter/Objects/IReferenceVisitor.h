@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Macros.h"
+
+namespace Finch
+{
+    class Value;
+
+    // Interface for walking the references from one object to others. See
+    // Object::VisitReferences().
+    class IReferenceVisitor
+    {
+    public:
+        virtual ~IReferenceVisitor() {}
+
+        // Called once for each value the object refers to. The value may be
+        // null.
+        virtual void Visit(const Value & value) = 0;
+    };
+}
@@ -0,0 +1,95 @@
+#include <cstring>
+#include <limits>
+
+#include "MapObject.h"
+#include "NumberObject.h"
+
+namespace Finch
+{
+    // Scrambles the bits of a 64-bit value into a 32-bit hash code. Doubles
+    // holding small integers and aligned pointers both have all of their
+    // low bits zero, so they need mixing before they can pick a slot.
+    static unsigned int MixBits(unsigned long long bits)
+    {
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdULL;
+        bits ^= bits >> 33;
+        bits *= 0xc4ceb9fe1a85ec53ULL;
+        bits ^= bits >> 33;
+        
+        return static_cast<unsigned int>(bits);
+    }
+    
+    unsigned int MapKeyTraits::Hash(const Value & key)
+    {
+        if (key.IsString()) return key.AsString().HashCode();
+        
+        if (key.IsNumber())
+        {
+            double number = key.AsNumber();
+            
+            // -0 equals 0 and every NaN equals every other one, so they
+            // need to hash the same too.
+            if (number == 0) number = 0;
+            if (number != number) number = std::numeric_limits<double>::quiet_NaN();
+            
+            unsigned long long bits;
+            memcpy(&bits, &number, sizeof(bits));
+            return MixBits(bits);
+        }
+        
+        // Everything else hashes by identity. The address of the object is
+        // the only identity it has.
+        return MixBits(reinterpret_cast<unsigned long long>(key.mObj));
+    }
+    
+    bool MapKeyTraits::Equals(const Value & a, const Value & b)
+    {
+        if (a == b) return true;
+        
+        if (a.IsNumber() && b.IsNumber())
+        {
+            double left = a.AsNumber();
+            double right = b.AsNumber();
+            
+            // Unlike =, a NaN key can be found again.
+            return (left == right) || ((left != left) && (right != right));
+        }
+        
+        if (a.IsString() && b.IsString())
+        {
+            return a.AsString() == b.AsString();
+        }
+        
+        return false;
+    }
+    
+    void MapObject::VisitReferences(IReferenceVisitor & visitor) const
+    {
+        Object::VisitReferences(visitor);
+        
+        for (Table::Iterator it(mItems); !it.IsDone(); it.Next())
+        {
+            visitor.Visit(it.Key());
+            visitor.Visit(it.Value());
+        }
+    }
+    
+    String MapObject::AsString() const
+    {
+        String text = "#{";
+        
+        bool first = true;
+        for (Table::Iterator it(mItems); !it.IsDone(); it.Next())
+        {
+            if (!first) text += ", ";
+            first = false;
+            
+            text += it.Key().AsString() + ": " + it.Value().AsString();
+        }
+        text += "}";
+        
+        return text;
+    }
+}
+
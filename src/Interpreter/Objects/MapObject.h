@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iostream>
+
+#include "Dictionary.h"
+#include "Macros.h"
+#include "Object.h"
+#include "FinchString.h"
+
+namespace Finch
+{
+    using std::ostream;
+    
+    // Dictionary traits for using Finch values as keys. Numbers and strings
+    // are compared by value, so that two equal strings find the same item.
+    // Everything else is compared by identity.
+    struct MapKeyTraits
+    {
+        static unsigned int Hash(const Value & key);
+        static bool Equals(const Value & a, const Value & b);
+    };
+    
+    // Object class for a hash map from any values to any values.
+    class MapObject : public Object
+    {
+    public:
+        typedef Dictionary<Value, Value, MapKeyTraits> Table;
+        
+        MapObject(const Value & parent)
+        :   Object(parent, OBJECT_MAP)
+        {
+        }
+        
+        // Gets the items. Add to them with Insert() instead of through
+        // this, so that the heap sees the table grow.
+        Table &       Items()       { return mItems; }
+        const Table & Items() const { return mItems; }
+        
+        // Maps the given key to the given value, replacing the value it was
+        // already mapped to, if any.
+        void Insert(const Value & key, const Value & value)
+        {
+            int oldSize = mItems.AllocatedBytes();
+            mItems.Insert(key, value);
+            
+            int newSize = mItems.AllocatedBytes();
+            if (newSize != oldSize) Resized(oldSize, newSize);
+        }
+        
+        virtual void Trace(ostream & stream) const
+        {
+            stream << AsString();
+        }
+        
+        virtual int GetSize() const
+        {
+            return static_cast<int>(sizeof(MapObject)) +
+                   mItems.AllocatedBytes();
+        }
+        
+        virtual void VisitReferences(IReferenceVisitor & visitor) const;
+        
+        virtual void ReleaseReferences()
+        {
+            Object::ReleaseReferences();
+            mItems.Clear();
+        }
+        
+        String AsString() const;
+        
+    private:
+        Table mItems;
+        
+        NO_COPY(MapObject);
+    };
+    
+    inline MapObject * Value::AsMap() const
+    {
+        if (Kind() != OBJECT_MAP) return NULL;
+        return static_cast<MapObject *>(mObj);
+    }
+}
+
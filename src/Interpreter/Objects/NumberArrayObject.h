@@ -0,0 +1,77 @@
+#pragma once
+
+#include <iostream>
+
+#include "Macros.h"
+#include "NumberFormat.h"
+#include "Object.h"
+#include "FinchString.h"
+
+namespace Finch
+{
+    using std::ostream;
+    
+    // Object class for a fixed-size array of numbers. Unlike ArrayObject,
+    // the numbers are stored directly as doubles, packed together, instead
+    // of as number objects, so that bulk math on them can be done with
+    // vector instructions.
+    class NumberArrayObject : public Object
+    {
+    public:
+        // Creates a new array of the given number of zeroes.
+        NumberArrayObject(const Value & parent, int count)
+        :   Object(parent, OBJECT_NUMBER_ARRAY),
+            mCount(count),
+            mValues(new double[count]())
+        {
+        }
+        
+        virtual ~NumberArrayObject()
+        {
+            delete [] mValues;
+        }
+        
+        int Count() const { return mCount; }
+        
+        double *       Values()       { return mValues; }
+        const double * Values() const { return mValues; }
+        
+        virtual void Trace(ostream & stream) const
+        {
+            stream << AsString();
+        }
+        
+        virtual int GetSize() const
+        {
+            return static_cast<int>(sizeof(NumberArrayObject) +
+                                    mCount * sizeof(double));
+        }
+        
+        String AsString() const
+        {
+            String text = "#[";
+            
+            for (int i = 0; i < mCount; i++)
+            {
+                if (i > 0) text += ", ";
+                text += NumberFormat::ToString(mValues[i]);
+            }
+            text += "]";
+            
+            return text;
+        }
+        
+    private:
+        int      mCount;
+        double * mValues;
+        
+        NO_COPY(NumberArrayObject);
+    };
+    
+    inline NumberArrayObject * Value::AsNumberArray() const
+    {
+        if (Kind() != OBJECT_NUMBER_ARRAY) return NULL;
+        return static_cast<NumberArrayObject *>(mObj);
+    }
+}
+
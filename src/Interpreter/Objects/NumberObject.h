@@ -1,9 +1,9 @@
 #pragma once
 
 #include <iostream>
-#include <sstream>
 
 #include "Macros.h"
+#include "NumberFormat.h"
 #include "Object.h"
 #include "Ref.h"
 #include "FinchString.h"
@@ -11,32 +11,44 @@
 namespace Finch
 {
     using std::ostream;
-    using std::stringstream;
     
     // Object class for a number. All numbers in Finch are floating point.
     class NumberObject : public Object
     {
     public:
         NumberObject(const Value & parent, double value)
-        :   Object(parent),
+        :   Object(parent, OBJECT_NUMBER),
             mValue(value)
         {}
         
         virtual void Trace(ostream & stream) const
         {
-            stream << mValue;
+            NumberFormat::Write(stream, mValue);
         }
         
-        virtual double AsNumber() const { return mValue; }
-        virtual String AsString() const
+        virtual int GetSize() const
         {
-            stringstream result;
-            result << mValue;
-            return String(result.str().c_str());
+            return static_cast<int>(sizeof(NumberObject));
         }
         
+        double AsNumber() const { return mValue; }
+        String AsString() const
+        {
+            return NumberFormat::ToString(mValue);
+        }
+        
+        // Changes the value of the number in place. See
+        // Value::TrySetNumber().
+        void SetNumber(double value) { mValue = value; }
+        
     private:
         double mValue;
     };    
+    
+    inline double Value::AsNumber() const
+    {
+        if (!IsNumber()) return 0;
+        return static_cast<NumberObject *>(mObj)->AsNumber();
+    }
 }
 
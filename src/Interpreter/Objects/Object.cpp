@@ -3,7 +3,10 @@
 #include "BlockObject.h"
 #include "DynamicObject.h"
 #include "FiberObject.h"
+#include "Heap.h"
 #include "Interpreter.h"
+#include "MapObject.h"
+#include "NumberArrayObject.h"
 #include "NumberObject.h"
 #include "Fiber.h"
 #include "StringObject.h"
@@ -74,18 +77,16 @@ namespace Finch
             if (dynamic != NULL)
             {
                 // See if the object has a method bound to that name.
-                Value method = dynamic->FindMethod(messageId);
-                if (!method.IsNull())
+                DynamicObject::Method method;
+                if (dynamic->FindMethod(messageId, &method))
                 {
-                    fiber.CallBlock(*this, method, args);
-                    return Value();
-                }
-                
-                // See if the object has a primitive bound to that name.
-                PrimitiveMethod primitive = dynamic->FindPrimitive(messageId);
-                if (primitive != NULL)
-                {
-                    return primitive(fiber, *this, args);
+                    if (!method.block.IsNull())
+                    {
+                        fiber.CallBlock(*this, method.block, args);
+                        return Value();
+                    }
+                    
+                    return method.primitive(fiber, *this, args);
                 }
             }
             
@@ -109,21 +110,66 @@ namespace Finch
         if (mObj != NULL)
         {
             mObj->mRefCount--;
+            Heap * heap = mObj->mHeap;
             if (mObj->mRefCount == 0)
             {
-                delete mObj;
+                if (heap != NULL) heap->Remove(mObj);
+                
+                // Its heap's root buffer still points to it, so it can't be
+                // freed until the next collection.
+                if (mObj->mIsBuffered)
+                {
+                    heap->ReleaseRoot(mObj);
+                }
+                else
+                {
+                    delete mObj;
+                }
+            }
+            else if ((mObj->mColor == COLOR_BLACK) && (heap != NULL))
+            {
+                // The released reference may have been the last one from
+                // outside of a cycle.
+                heap->PossibleRoot(mObj);
             }
             
             mObj = NULL;
         }
     }
         
-    double Value::AsNumber() const { return mObj->AsNumber(); }
-    String Value::AsString() const { return mObj->AsString(); }
-    ArrayObject * Value::AsArray() const { return mObj->AsArray(); }
-    BlockObject * Value::AsBlock() const { return mObj->AsBlock(); }
-    DynamicObject * Value::AsDynamic() const { return mObj->AsDynamic(); }
-    FiberObject * Value::AsFiber() const { return mObj->AsFiber(); }
+    bool Value::TrySetNumber(double value)
+    {
+        if ((mObj == NULL) || (mObj->mRefCount != 1) || !IsNumber()) return false;
+        
+        static_cast<NumberObject *>(mObj)->SetNumber(value);
+        return true;
+    }
+    
+    void Object::Resized(int oldSize, int newSize)
+    {
+        if (mHeap != NULL) mHeap->Resize(Kind(), oldSize, newSize);
+    }
+    
+    String Value::AsString() const
+    {
+        switch (Kind())
+        {
+            case OBJECT_ARRAY:
+                return static_cast<ArrayObject *>(mObj)->AsString();
+            case OBJECT_DYNAMIC:
+                return static_cast<DynamicObject *>(mObj)->AsString();
+            case OBJECT_MAP:
+                return static_cast<MapObject *>(mObj)->AsString();
+            case OBJECT_NUMBER:
+                return static_cast<NumberObject *>(mObj)->AsString();
+            case OBJECT_NUMBER_ARRAY:
+                return static_cast<NumberArrayObject *>(mObj)->AsString();
+            case OBJECT_STRING:
+                return static_cast<StringObject *>(mObj)->AsString();
+            default:
+                return "";
+        }
+    }
     
     ostream & operator<<(ostream & cout, const Value & value)
     {
@@ -4,6 +4,7 @@
 
 #include "Array.h"
 #include "ArgReader.h"
+#include "IReferenceVisitor.h"
 #include "Macros.h"
 #include "Ref.h"
 #include "FinchString.h"
@@ -19,18 +20,66 @@ namespace Finch
     class ArrayObject;
     class Block;
     class BlockObject;
+    class CycleCollector;
     class DynamicObject;
     class Environment;
     class Fiber;
     class FiberObject;
+    class Heap;
     class Interpreter;
+    class MapObject;
+    class NumberArrayObject;
     class Object;
+    struct MapKeyTraits;
+
+    // The concrete class of an Object. Values check this to see what kind of
+    // object they refer to instead of asking it through a virtual method.
+    enum ObjectKind
+    {
+        OBJECT_ARRAY,
+        OBJECT_BLOCK,
+        OBJECT_DYNAMIC,
+        OBJECT_FIBER,
+        OBJECT_MAP,
+        OBJECT_NUMBER,
+        OBJECT_NUMBER_ARRAY,
+        OBJECT_STRING
+    };
+
+    // The state of an object as far as the CycleCollector is concerned.
+    enum ObjectColor
+    {
+        // In use, or not looked at yet.
+        COLOR_BLACK,
+        
+        // Possibly garbage. Used while a collection is running.
+        COLOR_GRAY,
+        
+        // Garbage. Used while a collection is running.
+        COLOR_WHITE,
+        
+        // Had a reference to it released, so it may be the only way into a
+        // garbage cycle.
+        COLOR_PURPLE,
+        
+        // Can't be part of a cycle, so the collector never looks at it.
+        COLOR_GREEN
+    };
 
     typedef Value (*PrimitiveMethod)(Fiber & fiber, const Value & self,
                                      const ArgReader & args);
 
     class Value
     {
+        // Hashes objects by identity.
+        friend struct MapKeyTraits;
+        
+        // Reads the objects values refer to and their refcounts.
+        friend class CycleCollector;
+        
+        // Reads the objects values refer to.
+        friend class HeapDump;
+        
     public:
         // Constructs a new null value.
         Value()
@@ -48,7 +97,16 @@ namespace Finch
         // will point to the same object.
         Value(const Value & other);
         
-        ~Value() { Clear(); }
+        // Moves a value. This takes over the other value's reference, so
+        // the refcount doesn't change, and leaves the other value null.
+        Value(Value && other)
+        :   mObj(other.mObj)
+        {
+            other.mObj = NULL;
+        }
+        
+        // Moved-from values are null, so skip the call to Clear() for them.
+        ~Value() { if (mObj != NULL) Clear(); }
         
         Value GetField(int name) const;
         void SetField(int name, const Value & value) const;
@@ -69,23 +127,56 @@ namespace Finch
         
         Value & operator =(const Value & other);
         
+        // Moves a value.
+        Value & operator =(Value && other)
+        {
+            if (&other != this)
+            {
+                // Take the object before releasing ours in case other is
+                // only kept alive by it.
+                Object * obj = other.mObj;
+                other.mObj = NULL;
+                
+                if (mObj != NULL) Clear();
+                mObj = obj;
+            }
+            
+            return *this;
+        }
+        
         // Gets whether or not this value is nil.
         bool IsNull() const { return mObj == NULL; }
         
+        bool IsNumber() const;
+        bool IsString() const;
+        
+        // Gets the kind of object this refers to. Must not be null.
+        ObjectKind Kind() const;
+        
         // Clears the reference. If this was the last reference to the referred
         // object, it will be deallocated.
         void Clear();
         
+        // If this is the only reference to a number, changes the number's
+        // value in place and returns true. Used by loops to avoid allocating
+        // a new number each iteration when the last one wasn't kept.
+        bool TrySetNumber(double value);
+        
         const Value & Parent() const;
         
         void Trace(ostream & cout) const;
         
-        double          AsNumber() const;
-        String          AsString() const;
-        ArrayObject *   AsArray() const;
-        BlockObject *   AsBlock() const;
-        DynamicObject * AsDynamic() const;
-        FiberObject *   AsFiber() const;
+        // The conversions return 0, "", or NULL if this isn't the right
+        // kind of object. The inline ones are defined in the header for
+        // the object class they convert to.
+        inline double          AsNumber() const;
+        String                 AsString() const;
+        inline ArrayObject *   AsArray() const;
+        inline BlockObject *   AsBlock() const;
+        inline DynamicObject * AsDynamic() const;
+        inline FiberObject *   AsFiber() const;
+        inline NumberArrayObject * AsNumberArray() const;
+        inline MapObject *     AsMap() const;
         
     private:
         Object * mObj;
@@ -94,30 +185,84 @@ namespace Finch
     ostream & operator<<(ostream & cout, const Value & value);
 
     // Base class for an object in Finch. All values in Finch inherit from this.
+    // Each subclass passes its ObjectKind to the constructor so that a Value
+    // can be cast to it without going through the vtable.
     class Object
     {
+        friend class CycleCollector;
+        friend class Heap;
         friend class Value;
         
     public:
         virtual ~Object() {}
 
-        virtual double          AsNumber() const { return 0; }
-        virtual String          AsString() const { return ""; }
-        virtual ArrayObject *   AsArray()        { return NULL; }
-        virtual BlockObject *   AsBlock()        { return NULL; }
-        virtual DynamicObject * AsDynamic()      { return NULL; }
-        virtual FiberObject *   AsFiber()        { return NULL; }
-
+        ObjectKind Kind() const { return static_cast<ObjectKind>(mKind); }
+        
         const Value & Parent() const { return mParent; }
 
         virtual void Trace(ostream & stream) const = 0;
 
+        // Gets roughly how many bytes this object uses, including memory it
+        // owns but not memory it shares with other objects.
+        virtual int GetSize() const = 0;
+        
+        // Passes each value this object refers to to the visitor. Subclasses
+        // that refer to other values must override this and call the base
+        // method too.
+        virtual void VisitReferences(IReferenceVisitor & visitor) const
+        {
+            visitor.Visit(mParent);
+        }
+        
+        // Releases every value this object refers to, leaving it empty but
+        // safe to destroy. Used to break up garbage cycles.
+        virtual void ReleaseReferences()
+        {
+            mParent.Clear();
+        }
+        
+        // Gets whether objects of the given kind can never be part of a
+        // reference cycle. Numbers, strings and number arrays only refer to
+        // their prototype.
+        static bool IsAcyclic(ObjectKind kind)
+        {
+            return (kind == OBJECT_NUMBER) || (kind == OBJECT_NUMBER_ARRAY) ||
+                   (kind == OBJECT_STRING);
+        }
+        
     protected:
-        Object(const Value & parent) : mParent(parent), mRefCount(1) {}
+        Object(const Value & parent, ObjectKind kind)
+        :   mParent(parent),
+            mHeap(NULL),
+            mRefCount(1),
+            mKind(static_cast<unsigned char>(kind)),
+            mColor(static_cast<unsigned char>(
+                IsAcyclic(kind) ? COLOR_GREEN : COLOR_BLACK)),
+            mIsBuffered(false)
+        {}
+        
+        // Called when the memory this object owns has grown or shrunk, so
+        // that the heap it's in can keep count.
+        void Resized(int oldSize, int newSize);
 
     private:
-        Value mParent;
-        int   mRefCount;
+        Value         mParent;
+        
+        // The heap this object is counted in, or NULL if it isn't (yet, or
+        // any more).
+        Heap *        mHeap;
+        
+        int           mRefCount;
+        unsigned char mKind;
+        
+        // Bookkeeping for the CycleCollector. These fit in the padding after
+        // the kind.
+        unsigned char mColor;
+        bool          mIsBuffered;
     };
+    
+    inline ObjectKind Value::Kind() const { return mObj->Kind(); }
+    inline bool Value::IsNumber() const { return Kind() == OBJECT_NUMBER; }
+    inline bool Value::IsString() const { return Kind() == OBJECT_STRING; }
 }
 
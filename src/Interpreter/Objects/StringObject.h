@@ -16,7 +16,7 @@ namespace Finch
     {
     public:
         StringObject(const Value & parent, String value)
-        :   Object(parent),
+        :   Object(parent, OBJECT_STRING),
             mValue(value)
         {}
         
@@ -24,8 +24,16 @@ namespace Finch
         {
             stream << "\"" << mValue << "\"";
         }
+        
+        virtual int GetSize() const
+        {
+            // The characters may be shared with other strings, but count
+            // them anyway.
+            return static_cast<int>(sizeof(StringObject)) +
+                   mValue.Length() + 1;
+        }
             
-        virtual String AsString() const { return mValue; }
+        String AsString() const { return mValue; }
         
     private:
         String mValue;
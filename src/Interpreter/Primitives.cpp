@@ -5,8 +5,10 @@
 #include "BlockObject.h"
 #include "DynamicObject.h"
 #include "FiberObject.h"
+#include "Heap.h"
 #include "Interpreter.h"
 #include "IInterpreterHost.h"
+#include "NumberObject.h"
 #include "Primitives.h"
 #include "Fiber.h"
 #include "Object.h"
@@ -34,8 +36,26 @@ namespace Finch
         return fiber.Nil();
     }
     
+    PRIMITIVE(PrimitiveNumberArray)
+    {
+        int count = static_cast<int>(args[0].AsNumber());
+        if (count < 0)
+        {
+            fiber.Error("Cannot create an array with a negative count.");
+            return fiber.Nil();
+        }
+        
+        if (!fiber.EnsureHeap(count * sizeof(double))) return fiber.Nil();
+        
+        return fiber.GetInterpreter().NewNumberArray(count);
+    }
+    
+    PRIMITIVE(PrimitiveNewMap)
+    {
+        return fiber.GetInterpreter().NewMap();
+    }
+    
     // Primitives for manipulating fibers.
-    /*
     PRIMITIVE(PrimitiveNewFiber)
     {
         // get block arg
@@ -46,9 +66,10 @@ namespace Finch
             return fiber.Nil();
         }
         
-        return Object::NewFiber(fiber.GetInterpreter(), args[0]);
+        return fiber.GetInterpreter().NewFiber(args[0]);
     }
     
+    /*
     PRIMITIVE(PrimitiveGetCurrentFiber)
     {
         return fiber.GetInterpreter().GetCurrentFiber();
@@ -85,5 +106,16 @@ namespace Finch
     {
         return fiber.CreateNumber(fiber.GetCallstackDepth());
     }
+    
+    PRIMITIVE(PrimitiveCollect)
+    {
+        return fiber.CreateNumber(fiber.GetInterpreter().GetHeap().Collect());
+    }
+    
+    PRIMITIVE(PrimitiveLiveBytes)
+    {
+        size_t bytes = fiber.GetInterpreter().GetHeap().LiveBytes();
+        return fiber.CreateNumber(static_cast<double>(bytes));
+    }
 }
 
@@ -11,12 +11,16 @@ namespace Finch
     PRIMITIVE(PrimitiveStringCompare);
 
     PRIMITIVE(PrimitiveWrite);
+    PRIMITIVE(PrimitiveNumberArray);
+    PRIMITIVE(PrimitiveNewMap);
     
-    /*
     PRIMITIVE(PrimitiveNewFiber);
+    /*
     PRIMITIVE(PrimitiveGetCurrentFiber);
     PRIMITIVE(PrimitiveSwitchToFiber);
      */
     PRIMITIVE(PrimitiveGetCallstackDepth);
+    PRIMITIVE(PrimitiveCollect);
+    PRIMITIVE(PrimitiveLiveBytes);
 }
 
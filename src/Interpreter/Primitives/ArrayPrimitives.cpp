@@ -1,11 +1,217 @@
 #include "ArrayObject.h"
 #include "ArrayPrimitives.h"
+#include "BlockObject.h"
 #include "DynamicObject.h"
 #include "Fiber.h"
+#include "INativeLoop.h"
+#include "Interpreter.h"
+#include "NumberObject.h"
 #include "Object.h"
 
 namespace Finch
 {
+    // Base class for native loops that call a block with each element of an
+    // array in turn. They're passed the array both as the value the
+    // primitive was sent to, which keeps it alive while the loop runs, and
+    // as the ArrayObject the primitive has already checked it is.
+    class ArrayLoop : public INativeLoop
+    {
+    protected:
+        ArrayLoop(const Value & self, ArrayObject * array, const Value & block)
+        :   mBlock(block),
+            mSelf(self),
+            mArray(array),
+            mIndex(0),
+            mCount(array->Elements().Count())
+        {}
+        
+        // Gets whether a block has been called for an element yet. If so, the
+        // result passed to Step() is for Element().
+        bool HasStarted() const { return mIndex > 0; }
+        
+        // Advances to the next element. Returns false if there are no more.
+        // Only the elements the array had when the loop started are visited,
+        // so a block that adds to the array doesn't keep the loop going. The
+        // block may remove elements too, so the current count is checked as
+        // well.
+        bool Next()
+        {
+            Array<Value> & elements = mArray->Elements();
+            if ((mIndex >= mCount) || (mIndex >= elements.Count())) return false;
+            
+            mElement = elements[mIndex++];
+            return true;
+        }
+        
+        const Value & Element() const { return mElement; }
+        
+        Value mBlock;
+        
+    private:
+        Value         mSelf;
+        ArrayObject * mArray;
+        Value         mElement;
+        int           mIndex;
+        int           mCount;
+    };
+    
+    class EachLoop : public ArrayLoop
+    {
+    public:
+        EachLoop(const Value & self, ArrayObject * array, const Value & block)
+        :   ArrayLoop(self, array, block)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (!Next()) return fiber.Nil();
+            
+            fiber.CallLoopBlock(mBlock, Element());
+            return Value();
+        }
+    };
+    
+    // Like EachLoop, but also calls a second block in between each pair of
+    // elements.
+    class EachBetweenLoop : public ArrayLoop
+    {
+    public:
+        EachBetweenLoop(const Value & self, ArrayObject * array,
+                        const Value & block, const Value & between)
+        :   ArrayLoop(self, array, block),
+            mBetween(between),
+            mCalledBetween(false)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            // If that was the between block, the element is still waiting.
+            if (mCalledBetween)
+            {
+                mCalledBetween = false;
+                fiber.CallLoopBlock(mBlock, Element());
+                return Value();
+            }
+            
+            bool isFirst = !HasStarted();
+            if (!Next()) return fiber.Nil();
+            
+            if (isFirst)
+            {
+                fiber.CallLoopBlock(mBlock, Element());
+            }
+            else
+            {
+                mCalledBetween = true;
+                fiber.CallLoopBlock(mBetween);
+            }
+            
+            return Value();
+        }
+        
+    private:
+        Value mBetween;
+        bool  mCalledBetween;
+    };
+    
+    class MapLoop : public ArrayLoop
+    {
+    public:
+        MapLoop(Fiber & fiber, const Value & self, ArrayObject * array,
+                const Value & block)
+        :   ArrayLoop(self, array, block),
+            mResults(fiber.GetInterpreter().NewArray(
+                array->Elements().Count()))
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (HasStarted()) mResults.AsArray()->Add(result);
+            if (!Next()) return mResults;
+            
+            fiber.CallLoopBlock(mBlock, Element());
+            return Value();
+        }
+        
+    private:
+        Value mResults;
+    };
+    
+    // Collects the elements that the block returns true for, or, when
+    // rejecting, the ones it doesn't.
+    class SelectLoop : public ArrayLoop
+    {
+    public:
+        SelectLoop(Fiber & fiber, const Value & self, ArrayObject * array,
+                   const Value & block, bool keepIfTrue)
+        :   ArrayLoop(self, array, block),
+            mResults(fiber.GetInterpreter().NewArray(0)),
+            mKeepIfTrue(keepIfTrue)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (HasStarted() &&
+                ((result == fiber.CreateBool(true)) == mKeepIfTrue))
+            {
+                mResults.AsArray()->Add(Element());
+            }
+            
+            if (!Next()) return mResults;
+            
+            fiber.CallLoopBlock(mBlock, Element());
+            return Value();
+        }
+        
+    private:
+        Value mResults;
+        bool  mKeepIfTrue;
+    };
+    
+    class InjectLoop : public ArrayLoop
+    {
+    public:
+        InjectLoop(const Value & self, ArrayObject * array,
+                   const Value & initial, const Value & block)
+        :   ArrayLoop(self, array, block),
+            mValue(initial)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (HasStarted()) mValue = result;
+            if (!Next()) return mValue;
+            
+            fiber.CallLoopBlock(mBlock, mValue, Element());
+            return Value();
+        }
+        
+    private:
+        Value mValue;
+    };
+    
+    // Finds the first element the block returns true for.
+    class DetectLoop : public ArrayLoop
+    {
+    public:
+        DetectLoop(const Value & self, ArrayObject * array, const Value & block)
+        :   ArrayLoop(self, array, block)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (HasStarted() && (result == fiber.CreateBool(true)))
+            {
+                return Element();
+            }
+            
+            if (!Next()) return fiber.Nil();
+            
+            fiber.CallLoopBlock(mBlock, Element());
+            return Value();
+        }
+    };
+    
     PRIMITIVE(ArrayCount)
     {
         ArrayObject * array = self.AsArray();
@@ -19,7 +225,7 @@ namespace Finch
         ArrayObject * array = self.AsArray();
         ASSERT_NOT_NULL(array);
         
-        array->Elements().Add(args[0]);
+        array->Add(args[0]);
         return self;
     }
     
@@ -70,5 +276,98 @@ namespace Finch
         array->Elements().RemoveAt(index);
         return removed;
     }
+    
+    PRIMITIVE(ArrayConcat)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        ArrayObject * right = args[0].AsArray();
+        if (right == NULL)
+        {
+            fiber.Error("Can only concatenate an array with another array.");
+            return fiber.Nil();
+        }
+        
+        Value result = fiber.GetInterpreter().NewArray(
+            array->Elements().Count() + right->Elements().Count());
+        result.AsArray()->Elements().AddAll(array->Elements());
+        result.AsArray()->Elements().AddAll(right->Elements());
+        
+        return result;
+    }
+    
+    PRIMITIVE(ArrayEach)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new EachLoop(self, array, args[0]));
+    }
+    
+    PRIMITIVE(ArrayEachBetween)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        if (!fiber.ExpectBlock(args[1])) return fiber.Nil();
+        
+        return fiber.StartLoop(new EachBetweenLoop(self, array, args[0],
+                                                   args[1]));
+    }
+    
+    PRIMITIVE(ArrayMap)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new MapLoop(fiber, self, array, args[0]));
+    }
+    
+    PRIMITIVE(ArraySelect)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new SelectLoop(fiber, self, array, args[0],
+                                              true));
+    }
+    
+    PRIMITIVE(ArrayReject)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new SelectLoop(fiber, self, array, args[0],
+                                              false));
+    }
+    
+    PRIMITIVE(ArrayInjectInto)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[1])) return fiber.Nil();
+        
+        return fiber.StartLoop(new InjectLoop(self, array, args[0], args[1]));
+    }
+    
+    PRIMITIVE(ArrayDetect)
+    {
+        ArrayObject * array = self.AsArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new DetectLoop(self, array, args[0]));
+    }
 }
-
@@ -13,5 +13,15 @@ namespace Finch
     PRIMITIVE(ArrayAt);
     PRIMITIVE(ArrayAtPut);
     PRIMITIVE(ArrayRemoveAt);
+    
+    // Primitives that call a block for each element.
+    PRIMITIVE(ArrayConcat);
+    PRIMITIVE(ArrayEach);
+    PRIMITIVE(ArrayEachBetween);
+    PRIMITIVE(ArrayMap);
+    PRIMITIVE(ArraySelect);
+    PRIMITIVE(ArrayReject);
+    PRIMITIVE(ArrayInjectInto);
+    PRIMITIVE(ArrayDetect);
 }
 
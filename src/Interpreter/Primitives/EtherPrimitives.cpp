@@ -0,0 +1,75 @@
+#include "EtherPrimitives.h"
+#include "Fiber.h"
+#include "INativeLoop.h"
+#include "NumberObject.h"
+#include "Object.h"
+
+namespace Finch
+{
+    // Calls a block with each number from start while it's less than or
+    // equal to the end, adding the step each time.
+    class CountLoop : public INativeLoop
+    {
+    public:
+        CountLoop(double start, double end, double step, const Value & block)
+        :   mIndex(start),
+            mEnd(end),
+            mStep(step),
+            mBlock(block),
+            mHasStarted(false)
+        {}
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (mHasStarted) mIndex += mStep;
+            mHasStarted = true;
+            
+            if (mIndex > mEnd) return fiber.Nil();
+            
+            fiber.CallLoopBlock(mBlock, fiber.CreateNumber(mIndex));
+            return Value();
+        }
+        
+    private:
+        double mIndex;
+        double mEnd;
+        double mStep;
+        Value  mBlock;
+        bool   mHasStarted;
+    };
+    
+    static Value StartCountLoop(Fiber & fiber, double start, double end,
+                                double step, const Value & block)
+    {
+        if (!fiber.ExpectBlock(block)) return fiber.Nil();
+        
+        return fiber.StartLoop(new CountLoop(start, end, step, block));
+    }
+    
+    PRIMITIVE(EtherFromToDo)
+    {
+        if (!args[0].IsNumber() || !args[1].IsNumber())
+        {
+            fiber.Error("Loop bounds must be numbers.");
+            return fiber.Nil();
+        }
+        
+        double start = args[0].AsNumber();
+        double end = args[1].AsNumber();
+        
+        return StartCountLoop(fiber, start, end, (start <= end) ? 1 : -1,
+                              args[2]);
+    }
+    
+    PRIMITIVE(EtherFromToStepDo)
+    {
+        if (!args[0].IsNumber() || !args[1].IsNumber() || !args[2].IsNumber())
+        {
+            fiber.Error("Loop bounds must be numbers.");
+            return fiber.Nil();
+        }
+        
+        return StartCountLoop(fiber, args[0].AsNumber(), args[1].AsNumber(),
+                              args[2].AsNumber(), args[3]);
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Expr.h"
+#include "Macros.h"
+#include "Object.h"
+#include "Ref.h"
+
+namespace Finch
+{
+    // Primitive methods for Ether. Compiled code runs these loops inline when
+    // it can: see OP_FOR_PREP.
+    PRIMITIVE(EtherFromToDo);
+    PRIMITIVE(EtherFromToStepDo);
+}
+
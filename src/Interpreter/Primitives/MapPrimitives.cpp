@@ -0,0 +1,104 @@
+#include "Fiber.h"
+#include "INativeLoop.h"
+#include "Interpreter.h"
+#include "MapObject.h"
+#include "MapPrimitives.h"
+#include "Object.h"
+
+namespace Finch
+{
+    // Calls a block with each key and value in a map. The items are copied
+    // out when the loop starts, so the block is free to change the map.
+    class MapEachLoop : public INativeLoop
+    {
+    public:
+        MapEachLoop(const MapObject & map, const Value & block)
+        :   mBlock(block),
+            mKeys(map.Items().Count()),
+            mValues(map.Items().Count()),
+            mIndex(0)
+        {
+            for (MapObject::Table::Iterator it(map.Items()); !it.IsDone();
+                 it.Next())
+            {
+                mKeys.Add(it.Key());
+                mValues.Add(it.Value());
+            }
+        }
+        
+        virtual Value Step(Fiber & fiber, const Value & result)
+        {
+            if (mIndex >= mKeys.Count()) return fiber.Nil();
+            
+            fiber.CallLoopBlock(mBlock, mKeys[mIndex], mValues[mIndex]);
+            mIndex++;
+            return Value();
+        }
+        
+    private:
+        Value        mBlock;
+        Array<Value> mKeys;
+        Array<Value> mValues;
+        int          mIndex;
+    };
+    
+    PRIMITIVE(MapCount)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        return fiber.CreateNumber(map->Items().Count());
+    }
+    
+    PRIMITIVE(MapAt)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        Value value;
+        if (!map->Items().Find(args[0], &value)) return fiber.Nil();
+        
+        return value;
+    }
+    
+    PRIMITIVE(MapAtPut)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        map->Insert(args[0], args[1]);
+        return self;
+    }
+    
+    PRIMITIVE(MapContains)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        return fiber.CreateBool(map->Items().Contains(args[0]));
+    }
+    
+    PRIMITIVE(MapRemove)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        // Return the removed value, or nil if there wasn't one.
+        Value value;
+        if (!map->Items().Find(args[0], &value)) return fiber.Nil();
+        
+        map->Items().Remove(args[0]);
+        return value;
+    }
+    
+    PRIMITIVE(MapEach)
+    {
+        MapObject * map = self.AsMap();
+        ASSERT_NOT_NULL(map);
+        
+        if (!fiber.ExpectBlock(args[0])) return fiber.Nil();
+        
+        return fiber.StartLoop(new MapEachLoop(*map, args[0]));
+    }
+}
+
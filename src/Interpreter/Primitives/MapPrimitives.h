@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Expr.h"
+#include "Macros.h"
+#include "Object.h"
+#include "Ref.h"
+
+namespace Finch
+{
+    // Primitive methods for maps. Missing keys read as nil.
+    PRIMITIVE(MapCount);
+    PRIMITIVE(MapAt);
+    PRIMITIVE(MapAtPut);
+    PRIMITIVE(MapContains);
+    PRIMITIVE(MapRemove);
+    PRIMITIVE(MapEach);
+}
+
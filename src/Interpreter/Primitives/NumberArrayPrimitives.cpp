@@ -0,0 +1,195 @@
+#include "Fiber.h"
+#include "Interpreter.h"
+#include "NumberArrayObject.h"
+#include "NumberArrayPrimitives.h"
+#include "NumberKernels.h"
+#include "NumberObject.h"
+#include "Object.h"
+
+namespace Finch
+{
+    // Gets the other number array for an element-wise operation. Reports an
+    // error and returns NULL if it isn't one or isn't the same length.
+    static NumberArrayObject * ExpectSameLength(Fiber & fiber,
+                                                const NumberArrayObject & array,
+                                                const Value & value)
+    {
+        NumberArrayObject * other = value.AsNumberArray();
+        if (other == NULL)
+        {
+            fiber.Error("Must pass in a number array.");
+            return NULL;
+        }
+        
+        if (other->Count() != array.Count())
+        {
+            fiber.Error("Number arrays must be the same length.");
+            return NULL;
+        }
+        
+        return other;
+    }
+    
+    PRIMITIVE(NumberArrayCount)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        return fiber.CreateNumber(array->Count());
+    }
+    
+    PRIMITIVE(NumberArrayAt)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        int index = static_cast<int>(args[0].AsNumber());
+        
+        // allow negative indexes to index backwards from end
+        if (index < 0) index += array->Count();
+        if ((index < 0) || (index >= array->Count())) return fiber.Nil();
+        
+        return fiber.CreateNumber(array->Values()[index]);
+    }
+    
+    PRIMITIVE(NumberArrayAtPut)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        int index = static_cast<int>(args[0].AsNumber());
+        
+        // allow negative indexes to index backwards from end
+        if (index < 0) index += array->Count();
+        if ((index >= 0) && (index < array->Count()))
+        {
+            array->Values()[index] = args[1].AsNumber();
+        }
+        
+        return self;
+    }
+    
+    PRIMITIVE(NumberArraySum)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        return fiber.CreateNumber(NumberKernels::Sum(array->Values(),
+                                                     array->Count()));
+    }
+    
+    PRIMITIVE(NumberArrayMin)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (array->Count() == 0) return fiber.Nil();
+        
+        return fiber.CreateNumber(NumberKernels::Min(array->Values(),
+                                                     array->Count()));
+    }
+    
+    PRIMITIVE(NumberArrayMax)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        if (array->Count() == 0) return fiber.Nil();
+        
+        return fiber.CreateNumber(NumberKernels::Max(array->Values(),
+                                                     array->Count()));
+    }
+    
+    PRIMITIVE(NumberArrayDot)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        NumberArrayObject * other = ExpectSameLength(fiber, *array, args[0]);
+        if (other == NULL) return fiber.Nil();
+        
+        return fiber.CreateNumber(NumberKernels::Dot(
+            array->Values(), other->Values(), array->Count()));
+    }
+    
+    // Both of these are commutative, so they also handle the double-dispatch
+    // from a number on the left.
+    PRIMITIVE(NumberArrayAdd)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        NumberArrayObject * other = NULL;
+        if (args[0].AsNumberArray() != NULL)
+        {
+            other = ExpectSameLength(fiber, *array, args[0]);
+            if (other == NULL) return fiber.Nil();
+        }
+        
+        Value result = fiber.GetInterpreter().NewNumberArray(array->Count());
+        double * resultValues = result.AsNumberArray()->Values();
+        
+        if (other != NULL)
+        {
+            NumberKernels::Add(array->Values(), other->Values(), resultValues,
+                               array->Count());
+        }
+        else
+        {
+            NumberKernels::Add(array->Values(), args[0].AsNumber(),
+                               resultValues, array->Count());
+        }
+        
+        return result;
+    }
+    
+    PRIMITIVE(NumberArrayMultiply)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        NumberArrayObject * other = NULL;
+        if (args[0].AsNumberArray() != NULL)
+        {
+            other = ExpectSameLength(fiber, *array, args[0]);
+            if (other == NULL) return fiber.Nil();
+        }
+        
+        Value result = fiber.GetInterpreter().NewNumberArray(array->Count());
+        double * resultValues = result.AsNumberArray()->Values();
+        
+        if (other != NULL)
+        {
+            NumberKernels::Multiply(array->Values(), other->Values(),
+                                    resultValues, array->Count());
+        }
+        else
+        {
+            NumberKernels::Multiply(array->Values(), args[0].AsNumber(),
+                                    resultValues, array->Count());
+        }
+        
+        return result;
+    }
+    
+    PRIMITIVE(NumberArrayScale)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        // Unlike *, this changes the array in place.
+        NumberKernels::Multiply(array->Values(), args[0].AsNumber(),
+                                array->Values(), array->Count());
+        return self;
+    }
+    
+    PRIMITIVE(NumberArraySort)
+    {
+        NumberArrayObject * array = self.AsNumberArray();
+        ASSERT_NOT_NULL(array);
+        
+        NumberKernels::Sort(array->Values(), array->Count());
+        return self;
+    }
+}
+
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Expr.h"
+#include "Macros.h"
+#include "Object.h"
+#include "Ref.h"
+
+namespace Finch
+{
+    // Primitive methods for number arrays. at: and at:put: work like they
+    // do for regular arrays.
+    PRIMITIVE(NumberArrayCount);
+    PRIMITIVE(NumberArrayAt);
+    PRIMITIVE(NumberArrayAtPut);
+    
+    // Bulk math.
+    PRIMITIVE(NumberArraySum);
+    PRIMITIVE(NumberArrayMin);
+    PRIMITIVE(NumberArrayMax);
+    PRIMITIVE(NumberArrayDot);
+    PRIMITIVE(NumberArrayAdd);
+    PRIMITIVE(NumberArrayMultiply);
+    PRIMITIVE(NumberArrayScale);
+    PRIMITIVE(NumberArraySort);
+}
+
@@ -3,6 +3,7 @@
 #include "StringPrimitives.h"
 #include "DynamicObject.h"
 #include "Fiber.h"
+#include "NumberObject.h"
 #include "Object.h"
 
 namespace Finch
@@ -19,8 +20,7 @@ namespace Finch
         
         if ((index >= 0) && (index < thisString.Length()))
         {
-            String substring = String(thisString[index]);
-            return fiber.CreateString(substring);
+            return fiber.CreateCharacter(thisString[index]);
         }
         else
         {
@@ -35,9 +35,16 @@ namespace Finch
         int    from       = static_cast<int>(args[0].AsNumber());
         int    count      = static_cast<int>(args[1].AsNumber());
         
-        // TODO(bob): Bounds check.
-        String substring = String(thisString.Substring(from, count));
-        return fiber.CreateString(substring);
+        if ((from < 0) || (count < 0) || (from + count > thisString.Length()))
+        {
+            // out of bounds
+            return fiber.Nil();
+        }
+        
+        // Single characters are shared instead of slicing.
+        if (count == 1) return fiber.CreateCharacter(thisString[from]);
+        
+        return fiber.CreateString(thisString.Substring(from, count));
     }
     
     PRIMITIVE(StringIndexOf)
@@ -48,6 +55,14 @@ namespace Finch
         return fiber.CreateNumber(thisString.IndexOf(needle));
     }
     
+    PRIMITIVE(StringLastIndexOf)
+    {
+        String thisString = self.AsString();
+        String needle     = args[0].AsString();
+        
+        return fiber.CreateNumber(thisString.LastIndexOf(needle));
+    }
+    
     PRIMITIVE(StringHashCode)
     {
         return fiber.CreateNumber(static_cast<double>(self.AsString().HashCode()));
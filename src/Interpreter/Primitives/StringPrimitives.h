@@ -13,6 +13,7 @@ namespace Finch
     PRIMITIVE(StringAt);
     PRIMITIVE(StringFromCount);
     PRIMITIVE(StringIndexOf);
+    PRIMITIVE(StringLastIndexOf);
     PRIMITIVE(StringHashCode);
 }
 
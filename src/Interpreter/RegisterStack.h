@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Macros.h"
+
+namespace Finch
+{
+    // The registers for all of the call frames in a fiber, stored in one
+    // contiguous block. The stack will not grow past a maximum size, so
+    // runaway recursion is reported as an error instead of using up all
+    // memory.
+    //
+    // The registers are allocated with calloc() and moved with realloc()
+    // instead of new[], which would construct and copy them one at a time.
+    // That means T must be null when all of its bits are zero and must not
+    // care where it lives in memory. Value is both, since it's a single
+    // pointer. (It's a template only so that ArgReader can use it before
+    // Value has been defined.)
+    template <class T>
+    class RegisterStack
+    {
+    public:
+        RegisterStack(int capacity, int maxSize)
+        :   mItems(NULL),
+            mCount(0),
+            mCapacity(0),
+            mMaxSize(maxSize)
+        {
+            if (capacity > maxSize) capacity = maxSize;
+
+            mItems = static_cast<T *>(calloc(capacity, sizeof(T)));
+            mCapacity = capacity;
+        }
+
+        ~RegisterStack()
+        {
+            Clear(0, mCount);
+            free(mItems);
+        }
+
+        // Gets the number of registers in use. This is one past the highest
+        // register that has been asked for. It doesn't shrink when frames
+        // are popped.
+        int Count() const { return mCount; }
+
+        // Gets the number of registers there is room for without growing.
+        int Capacity() const { return mCapacity; }
+
+        int MaxSize() const { return mMaxSize; }
+
+        // Makes sure there are at least count registers. New registers are
+        // null. Returns false, and leaves the stack alone, if that would be
+        // more than the maximum size.
+        bool Ensure(int count)
+        {
+            if (count <= mCount) return true;
+            if ((count > mCapacity) && !Grow(count)) return false;
+
+            mCount = count;
+            return true;
+        }
+
+        // Sets count registers starting at index to value.
+        void Fill(int index, int count, const T & value)
+        {
+            ASSERT(index + count <= mCount,
+                   "Cannot fill past the end of the stack.");
+
+            for (int i = index; i < index + count; i++)
+            {
+                mItems[i] = value;
+            }
+        }
+
+        // Clears the registers from start up to, but not including, end.
+        void Clear(int start, int end)
+        {
+            for (int i = start; i < end; i++)
+            {
+                mItems[i].Clear();
+            }
+        }
+
+        T & operator[] (int index)
+        {
+            ASSERT_RANGE(index, mCount);
+            return mItems[index];
+        }
+
+        const T & operator[] (int index) const
+        {
+            ASSERT_RANGE(index, mCount);
+            return mItems[index];
+        }
+
+    private:
+        bool Grow(int count)
+        {
+            if (count > mMaxSize) return false;
+
+            int capacity = (mCapacity < 16) ? 16 : mCapacity;
+            while (capacity < count) capacity *= 2;
+            if (capacity > mMaxSize) capacity = mMaxSize;
+
+            void * items = realloc(static_cast<void *>(mItems),
+                                   capacity * sizeof(T));
+            if (items == NULL) return false;
+
+            // Null out the new registers.
+            memset(static_cast<char *>(items) + mCapacity * sizeof(T), 0,
+                   (capacity - mCapacity) * sizeof(T));
+
+            mItems = static_cast<T *>(items);
+            mCapacity = capacity;
+            return true;
+        }
+
+        T * mItems;
+        int mCount;
+        int mCapacity;
+        int mMaxSize;
+
+        NO_COPY(RegisterStack);
+    };
+}
+
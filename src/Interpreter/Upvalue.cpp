@@ -2,7 +2,7 @@
 
 namespace Finch
 {
-    Value Upvalue::Get(Array<Value> & stack) const
+    Value Upvalue::Get(RegisterStack<Value> & stack) const
     {
         if (IsOpen())
         {
@@ -14,7 +14,7 @@ namespace Finch
         }
     }
     
-    void Upvalue::Set(Array<Value> & stack, const Value & value)
+    void Upvalue::Set(RegisterStack<Value> & stack, const Value & value)
     {
         if (IsOpen())
         {
@@ -26,7 +26,7 @@ namespace Finch
         }
     }
     
-    void Upvalue::Close(Array<Value> & stack)
+    void Upvalue::Close(RegisterStack<Value> & stack)
     {
         // Capture the value.
         mValue = stack[mStackIndex];
@@ -44,5 +44,11 @@ namespace Finch
     {
         return mStackIndex != -1;
     }
+    
+    const Value & Upvalue::ClosedValue() const
+    {
+        ASSERT(!IsOpen(), "Can only get the value of a closed upvalue.");
+        return mValue;
+    }
 }
 
@@ -7,6 +7,7 @@
 #include "Macros.h"
 #include "Object.h"
 #include "Ref.h"
+#include "RegisterStack.h"
 
 namespace Finch
 {
@@ -25,20 +26,19 @@ namespace Finch
         :   mStackIndex(stackIndex)
         {}
         
-        Value Get(Array<Value> & stack) const;        
-        void Set(Array<Value> & stack, const Value & value);        
-        void Close(Array<Value> & stack);        
+        Value Get(RegisterStack<Value> & stack) const;        
+        void Set(RegisterStack<Value> & stack, const Value & value);        
+        void Close(RegisterStack<Value> & stack);        
         int Index() const;        
         bool IsOpen() const;
-
-        Ref<Upvalue> Next() const { return mNext; }
-        void SetNext(Ref<Upvalue> upvalue) { mNext = upvalue; }
+        
+        // Gets the captured value of a closed upvalue.
+        const Value & ClosedValue() const;
 
     private:
         // TODO(bob): Can use a union for some of this.
         int mStackIndex;    // Will be -1 if Upvalue is closed.
         Value mValue; // Only use when Upvalue is closed.
-        Ref<Upvalue> mNext;
     };
 }
 
@@ -1,5 +1,6 @@
 #include <new>
 
+#include "Macros.h"
 #include "StandaloneInterpreterHost.h"
 
 namespace Finch
@@ -46,6 +46,8 @@ namespace Finch
             stream << " " << mBody << " }";
         }
             
+        virtual const BlockExpr * AsBlock() const { return this; }
+        
         EXPRESSION_VISITOR
 
     private:
@@ -18,8 +18,10 @@ namespace Finch
 {
     using std::ostream;
     
+    class BlockExpr;
     class IExprCompiler;
     class IExprVisitor;
+    class NameExpr;
     class Object;
         
     class Expr
@@ -36,6 +38,10 @@ namespace Finch
         
         virtual ~Expr() {}
         
+        // Downcasts, so that the compiler can recognize particular forms.
+        virtual const BlockExpr * AsBlock() const { return NULL; }
+        virtual const NameExpr *  AsName()  const { return NULL; }
+        
         // The visitor pattern.
         virtual void Accept(IExprCompiler & compiler, int dest) const = 0;
         
@@ -25,6 +25,8 @@ namespace Finch
             stream << mName;
         }
         
+        virtual const NameExpr * AsName() const { return this; }
+        
         EXPRESSION_VISITOR
         
     private:
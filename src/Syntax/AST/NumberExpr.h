@@ -6,6 +6,7 @@
 #include "Expr.h"
 #include "IExprCompiler.h"
 #include "FinchString.h"
+#include "NumberFormat.h"
 
 namespace Finch
 {
@@ -23,7 +24,7 @@ namespace Finch
         
         virtual void Trace(ostream & stream) const
         {
-            stream << mValue;
+            NumberFormat::Write(stream, mValue);
         }
         
         EXPRESSION_VISITOR
@@ -50,6 +50,29 @@ namespace Finch
         }
     }
     
+    Ref<Expr> FinchParser::ParseTopLevel()
+    {
+        // Once we've failed, the token stream is in an unknown state, so don't
+        // try to keep going.
+        if (HadError()) return Ref<Expr>();
+        
+        if (LookAhead(TOKEN_EOF)) return Ref<Expr>();
+        
+        Ref<Expr> expr = Variable();
+        
+        // Top-level expressions are separated by newlines, just like the
+        // expressions in a sequence.
+        if (!Match(TOKEN_LINE))
+        {
+            Expect(TOKEN_EOF, "Parser ended unexpectedly before reaching end of file.");
+        }
+        
+        // Don't return anything if we had a parse error.
+        if (HadError()) return Ref<Expr>();
+        
+        return expr;
+    }
+    
     Ref<Expr> FinchParser::Expression()
     {
         Ref<Expr> expr = Sequence();
@@ -26,6 +26,12 @@ namespace Finch
         // this is an infinite source, it will return as soon as a complete
         // expression is parsed. Otherwise, it will parse the entire source.
         Ref<Expr> Parse();
+        
+        // Reads a single top-level expression from a finite token source.
+        // Returns a null reference once the source is exhausted or if a parse
+        // error occurred. Unlike Parse(), this lets the caller execute and
+        // discard each expression before the next one is parsed.
+        Ref<Expr> ParseTopLevel();
 
     private:
         // The grammar productions, from lowest to highest precedence.
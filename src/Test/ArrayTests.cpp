@@ -1,5 +1,8 @@
+#include <utility>
+
 #include "ArrayTests.h"
 #include "Array.h"
+#include "NumberObject.h"
 
 namespace Finch
 {
@@ -9,6 +12,9 @@ namespace Finch
         TestSubscript();
         TestRemoveAt();
         TestTruncate();
+        TestClear();
+        TestMove();
+        
     }
     
     void ArrayTests::TestCtor()
@@ -96,5 +102,54 @@ namespace Finch
         array.Truncate(0);
         EXPECT_EQUAL(0, array.Count());
     }
+    
+    void ArrayTests::TestClear()
+    {
+        Array<char> array;
+        array.Add('a');
+        array.Add('b');
+        
+        array.Clear();
+        EXPECT_EQUAL(0, array.Count());
+        EXPECT_EQUAL(0, array.Capacity());
+        
+        // A cleared array can be used again, and destroyed.
+        array.Add('c');
+        EXPECT_EQUAL(1, array.Count());
+        EXPECT_EQUAL('c', array[0]);
+    }
+    
+    void ArrayTests::TestMove()
+    {
+        Value number(new NumberObject(Value(), 1));
+        
+        // Moving an item in leaves the original null.
+        Array<Value> array;
+        Value moved = number;
+        array.Add(std::move(moved));
+        
+        EXPECT(moved.IsNull());
+        EXPECT(array[0] == number);
+        
+        // Growing and shifting keep the items.
+        for (int i = 0; i < 100; i++) array.Add(number);
+        array.RemoveAt(0);
+        
+        EXPECT_EQUAL(100, array.Count());
+        EXPECT(array[0] == number);
+        EXPECT(array[-1] == number);
+        
+        // Moving a whole array takes its items and leaves it empty.
+        Array<Value> other(std::move(array));
+        
+        EXPECT_EQUAL(0, array.Count());
+        EXPECT_EQUAL(100, other.Count());
+        
+        array = std::move(other);
+        
+        EXPECT_EQUAL(100, array.Count());
+        EXPECT_EQUAL(0, other.Count());
+        EXPECT(array[50] == number);
+    }
 }
 
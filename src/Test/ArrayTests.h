@@ -14,6 +14,8 @@ namespace Finch
         static void TestSubscript();
         static void TestRemoveAt();
         static void TestTruncate();
+        static void TestClear();
+        static void TestMove();
     };
 }
 
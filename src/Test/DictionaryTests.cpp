@@ -0,0 +1,321 @@
+#include "DictionaryTests.h"
+#include "Dictionary.h"
+#include "FinchString.h"
+
+namespace Finch
+{
+    // Keys whose hash codes are chosen by the test so that it can control
+    // which ones collide.
+    struct CollidingTraits
+    {
+        static unsigned int Hash(int key) { return key / 100; }
+        static bool Equals(int a, int b) { return a == b; }
+    };
+    
+    void DictionaryTests::Run()
+    {
+        TestInsertFind();
+        TestInsertReplaces();
+        TestGrow();
+        TestRemove();
+        TestRemoveCollisions();
+        TestIterator();
+        TestFindKeyForValue();
+        TestEmptyKey();
+        TestClear();
+        TestCopyFrom();
+        TestReserve();
+        TestPointerKeys();
+    }
+    
+    void DictionaryTests::TestInsertFind()
+    {
+        Dictionary<String, int> dictionary;
+        
+        EXPECT_EQUAL(0, dictionary.Count());
+        
+        int value = -1;
+        EXPECT(!dictionary.Find("a", &value));
+        
+        dictionary.Insert("a", 1);
+        dictionary.Insert("b", 2);
+        
+        EXPECT_EQUAL(2, dictionary.Count());
+        EXPECT(dictionary.Find("a", &value));
+        EXPECT_EQUAL(1, value);
+        EXPECT(dictionary.Find("b", &value));
+        EXPECT_EQUAL(2, value);
+        EXPECT(dictionary.Contains("a"));
+        EXPECT(!dictionary.Contains("c"));
+    }
+    
+    void DictionaryTests::TestInsertReplaces()
+    {
+        Dictionary<String, int> dictionary;
+        
+        dictionary.Insert("a", 1);
+        dictionary.Insert("a", 2);
+        
+        int value = -1;
+        EXPECT_EQUAL(1, dictionary.Count());
+        EXPECT(dictionary.Find("a", &value));
+        EXPECT_EQUAL(2, value);
+        
+        EXPECT(dictionary.Replace("a", 3));
+        EXPECT(!dictionary.Replace("b", 4));
+        EXPECT_EQUAL(1, dictionary.Count());
+    }
+    
+    void DictionaryTests::TestGrow()
+    {
+        IdTable<int> table;
+        
+        for (int i = 0; i < 1000; i++)
+        {
+            table.Insert(i * 7, i);
+        }
+        
+        EXPECT_EQUAL(1000, table.Count());
+        
+        for (int i = 0; i < 1000; i++)
+        {
+            int value = -1;
+            EXPECT(table.Find(i * 7, &value));
+            EXPECT_EQUAL(i, value);
+        }
+        
+        EXPECT(!table.Contains(1));
+    }
+    
+    void DictionaryTests::TestRemove()
+    {
+        Dictionary<String, int> dictionary;
+        
+        dictionary.Insert("a", 1);
+        dictionary.Insert("b", 2);
+        
+        EXPECT(dictionary.Remove("a"));
+        EXPECT(!dictionary.Remove("a"));
+        EXPECT(!dictionary.Remove("c"));
+        
+        EXPECT_EQUAL(1, dictionary.Count());
+        EXPECT(!dictionary.Contains("a"));
+        EXPECT(dictionary.Contains("b"));
+    }
+    
+    void DictionaryTests::TestRemoveCollisions()
+    {
+        // Removing an item from the middle of a run of colliding keys must
+        // not hide the ones after it.
+        Dictionary<int, int, CollidingTraits> dictionary;
+        
+        dictionary.Insert(101, 1);
+        dictionary.Insert(102, 2);
+        dictionary.Insert(103, 3);
+        dictionary.Insert(201, 4);
+        dictionary.Insert(104, 5);
+        dictionary.Insert(301, 6);
+        
+        EXPECT(dictionary.Remove(102));
+        
+        int value = -1;
+        EXPECT(dictionary.Find(101, &value));
+        EXPECT_EQUAL(1, value);
+        EXPECT(dictionary.Find(103, &value));
+        EXPECT_EQUAL(3, value);
+        EXPECT(dictionary.Find(201, &value));
+        EXPECT_EQUAL(4, value);
+        EXPECT(dictionary.Find(104, &value));
+        EXPECT_EQUAL(5, value);
+        EXPECT(dictionary.Find(301, &value));
+        EXPECT_EQUAL(6, value);
+        EXPECT(!dictionary.Contains(102));
+        
+        // Remove everything, in an order that leaves holes in the middle of
+        // runs.
+        int keys[] = { 201, 101, 301, 104, 103 };
+        for (int i = 0; i < 5; i++)
+        {
+            EXPECT(dictionary.Remove(keys[i]));
+            for (int j = i + 1; j < 5; j++)
+            {
+                EXPECT(dictionary.Contains(keys[j]));
+            }
+        }
+        EXPECT_EQUAL(0, dictionary.Count());
+        
+        // Runs that wrap around the end of the table.
+        Dictionary<int, int, CollidingTraits> wrapped;
+        
+        wrapped.Insert(1501, 1);
+        wrapped.Insert(1502, 2);
+        wrapped.Insert(1503, 3);
+        wrapped.Insert(1504, 4);
+        wrapped.Insert(1, 5);
+        
+        EXPECT(wrapped.Remove(1501));
+        EXPECT(wrapped.Remove(1503));
+        
+        EXPECT_EQUAL(3, wrapped.Count());
+        EXPECT(wrapped.Contains(1502));
+        EXPECT(wrapped.Contains(1504));
+        EXPECT(wrapped.Contains(1));
+        EXPECT(!wrapped.Contains(1501));
+        EXPECT(!wrapped.Contains(1503));
+    }
+    
+    void DictionaryTests::TestIterator()
+    {
+        IdTable<int> table;
+        
+        typedef Dictionary<StringId, int>::Iterator Iterator;
+        EXPECT(Iterator(table).IsDone());
+        
+        for (int i = 1; i <= 10; i++)
+        {
+            table.Insert(i, i * 10);
+        }
+        table.Remove(5);
+        
+        int count = 0;
+        int keySum = 0;
+        for (Iterator it(table); !it.IsDone(); it.Next())
+        {
+            EXPECT_EQUAL(it.Key() * 10, it.Value());
+            keySum += it.Key();
+            count++;
+        }
+        
+        EXPECT_EQUAL(9, count);
+        EXPECT_EQUAL(50, keySum);
+    }
+    
+    void DictionaryTests::TestFindKeyForValue()
+    {
+        IdTable<int> table;
+        
+        table.Insert(3, 0);
+        table.Insert(4, 7);
+        
+        EXPECT_EQUAL(3, table.FindKeyForValue(0));
+        EXPECT_EQUAL(4, table.FindKeyForValue(7));
+        EXPECT_EQUAL(NO_STRING, table.FindKeyForValue(8));
+        
+        // Once it has grown out of the inline storage.
+        for (int i = 10; i < 20; i++) table.Insert(i, i * 2);
+        EXPECT_EQUAL(15, table.FindKeyForValue(30));
+    }
+    
+    void DictionaryTests::TestEmptyKey()
+    {
+        // Any key can be stored, even a default-constructed one.
+        Dictionary<String, int> dictionary;
+        
+        dictionary.Insert("", 1);
+        
+        int value = -1;
+        EXPECT(dictionary.Find("", &value));
+        EXPECT_EQUAL(1, value);
+        EXPECT(!dictionary.Contains("a"));
+        
+        IdTable<int> table;
+        table.Insert(0, 2);
+        EXPECT(table.Find(0, &value));
+        EXPECT_EQUAL(2, value);
+    }
+    
+    void DictionaryTests::TestClear()
+    {
+        Dictionary<String, int> small;
+        small.Insert("a", 1);
+        small.Clear();
+        
+        EXPECT_EQUAL(0, small.Count());
+        EXPECT(!small.Contains("a"));
+        
+        // Clearing a grown table must leave it usable.
+        IdTable<int> table;
+        for (int i = 0; i < 100; i++) table.Insert(i, i);
+        table.Clear();
+        
+        EXPECT_EQUAL(0, table.Count());
+        EXPECT(!table.Contains(5));
+        
+        table.Insert(5, 6);
+        int value = -1;
+        EXPECT(table.Find(5, &value));
+        EXPECT_EQUAL(6, value);
+    }
+    
+    void DictionaryTests::TestCopyFrom()
+    {
+        IdTable<int> small;
+        small.Insert(1, 10);
+        small.Insert(2, 20);
+        
+        IdTable<int> big;
+        for (int i = 0; i < 50; i++) big.Insert(i, i * 10);
+        
+        // Copying over a table that has grown replaces its contents.
+        IdTable<int> copy;
+        for (int i = 100; i < 200; i++) copy.Insert(i, i);
+        
+        copy.CopyFrom(small);
+        EXPECT_EQUAL(2, copy.Count());
+        EXPECT(!copy.Contains(100));
+        
+        int value = -1;
+        EXPECT(copy.Find(2, &value));
+        EXPECT_EQUAL(20, value);
+        
+        copy.CopyFrom(big);
+        EXPECT_EQUAL(50, copy.Count());
+        for (int i = 0; i < 50; i++)
+        {
+            EXPECT(copy.Find(i, &value));
+            EXPECT_EQUAL(i * 10, value);
+        }
+        
+        // The copy is independent of the original.
+        copy.Remove(3);
+        copy.Insert(60, 600);
+        EXPECT(big.Contains(3));
+        EXPECT(!big.Contains(60));
+    }
+    
+    void DictionaryTests::TestReserve()
+    {
+        IdTable<int> table;
+        table.Reserve(2);
+        table.Reserve(100);
+        
+        for (int i = 0; i < 100; i++) table.Insert(i, i);
+        table.Reserve(10);
+        
+        EXPECT_EQUAL(100, table.Count());
+        for (int i = 0; i < 100; i++)
+        {
+            EXPECT(table.Contains(i));
+        }
+    }
+    
+    void DictionaryTests::TestPointerKeys()
+    {
+        int items[100];
+        Dictionary<const int *, int> table;
+        
+        for (int i = 0; i < 100; i++) table.Insert(&items[i], i);
+        
+        EXPECT_EQUAL(100, table.Count());
+        for (int i = 0; i < 100; i++)
+        {
+            int value = -1;
+            EXPECT(table.Find(&items[i], &value));
+            EXPECT_EQUAL(i, value);
+        }
+        
+        EXPECT(table.Remove(&items[50]));
+        EXPECT(!table.Contains(&items[50]));
+        EXPECT(table.Contains(&items[51]));
+    }
+}
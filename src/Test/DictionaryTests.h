@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Test.h"
+
+namespace Finch
+{
+    class DictionaryTests : public Test
+    {
+    public:
+        static void Run();
+        
+    private:
+        static void TestInsertFind();
+        static void TestInsertReplaces();
+        static void TestGrow();
+        static void TestRemove();
+        static void TestRemoveCollisions();
+        static void TestIterator();
+        static void TestFindKeyForValue();
+        static void TestEmptyKey();
+        static void TestClear();
+        static void TestCopyFrom();
+        static void TestReserve();
+        static void TestPointerKeys();
+    };
+}
+
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "FinchString.h"
+#include "ILineReader.h"
+
+namespace Finch
+{
+    // Reads a single line of code given to it up front.
+    class FixedLineReader : public ILineReader
+    {
+    public:
+        FixedLineReader(const char * line)
+        : mLine(line)
+        {}
+        
+        virtual bool IsInfinite() const { return false; }
+        virtual bool EndOfLines() const { return mLine == NULL; }
+        
+        virtual String NextLine()
+        {
+            String line = mLine;
+            // only read the line once
+            mLine = NULL;
+            
+            return line;
+        }
+        
+    private:
+        const char * mLine;
+    };
+}
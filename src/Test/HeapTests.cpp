@@ -0,0 +1,336 @@
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "HeapTests.h"
+#include "ArrayObject.h"
+#include "FixedLineReader.h"
+#include "Heap.h"
+#include "IInterpreterHost.h"
+#include "Interpreter.h"
+#include "NumberObject.h"
+
+namespace Finch
+{
+    // Collects the errors an interpreter reports.
+    class HeapTestHost : public IInterpreterHost
+    {
+    public:
+        virtual void * Allocate(size_t size) { return NULL; }
+        virtual void Free(void * data) {}
+        virtual void Output(const String & text) {}
+        virtual void Error(const String & message) { mErrors.Add(message); }
+
+        Array<String> & Errors() { return mErrors; }
+
+    private:
+        Array<String> mErrors;
+    };
+
+    static void Interpret(Interpreter & interpreter, const char * line)
+    {
+        FixedLineReader reader(line);
+        interpreter.Interpret(reader, false);
+    }
+
+    static const Value & Global(Interpreter & interpreter, const char * name)
+    {
+        return interpreter.GetGlobal(interpreter.FindGlobal(name));
+    }
+
+    static std::string DumpHeap(Interpreter & interpreter)
+    {
+        std::stringstream dump;
+        interpreter.DumpHeap(dump);
+        return dump.str();
+    }
+
+    // Reads the retained size of the given global out of a heap dump.
+    static size_t Retained(const std::string & dump, const char * name)
+    {
+        std::string global = std::string("{\"name\": \"") + name + "\"";
+        size_t start = dump.find(global);
+        if (start == std::string::npos) return 0;
+
+        size_t retained = dump.find("\"retained\": ", start);
+        return strtoul(dump.c_str() + retained + 12, NULL, 10);
+    }
+
+    void HeapTests::Run()
+    {
+        TestCountsObjects();
+        TestCountsGrowth();
+        TestCountsCycles();
+        TestCollectsOwnHeap();
+        TestCountsBlocks();
+        TestSoftLimit();
+        TestHardLimit();
+        TestHardLimitOnLargeAllocation();
+        TestStackOverflow();
+        TestDumpObjects();
+        TestDumpRetainedSizes();
+        TestDumpSites();
+    }
+
+    void HeapTests::TestCountsObjects()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        // The interpreter's own globals are counted.
+        EXPECT(heap.LiveObjects(OBJECT_DYNAMIC) > 0);
+        EXPECT(heap.LiveObjects(OBJECT_STRING) > 0);
+
+        int arrays = heap.LiveObjects(OBJECT_ARRAY);
+        int strings = heap.LiveObjects(OBJECT_STRING);
+        size_t arrayBytes = heap.LiveBytes(OBJECT_ARRAY);
+        size_t bytes = heap.LiveBytes();
+
+        Interpret(interpreter, "Things <- #[\"a long enough string\"]");
+        EXPECT_EQUAL(arrays + 1, heap.LiveObjects(OBJECT_ARRAY));
+        EXPECT_EQUAL(strings + 1, heap.LiveObjects(OBJECT_STRING));
+        EXPECT(heap.LiveBytes(OBJECT_ARRAY) > arrayBytes);
+        EXPECT(heap.LiveBytes() > bytes);
+
+        // Freeing them takes them back out.
+        Interpret(interpreter, "Things <- nil");
+        EXPECT_EQUAL(arrays, heap.LiveObjects(OBJECT_ARRAY));
+        EXPECT_EQUAL(strings, heap.LiveObjects(OBJECT_STRING));
+        EXPECT_EQUAL(arrayBytes, heap.LiveBytes(OBJECT_ARRAY));
+        EXPECT_EQUAL(bytes, heap.LiveBytes());
+    }
+
+    void HeapTests::TestCountsGrowth()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        size_t bytes = heap.LiveBytes();
+
+        Interpret(interpreter, "Things <- #[]");
+        size_t emptyBytes = heap.LiveBytes(OBJECT_ARRAY);
+
+        Interpret(interpreter, "from: 1 to: 1000 do: {|i| Things add: i }");
+        EXPECT(heap.LiveBytes(OBJECT_ARRAY) >= emptyBytes + 1000 * sizeof(Value));
+
+        Interpret(interpreter, "Stuff <- [ _a <- 1 ]");
+        Interpret(interpreter,
+                  "Stuff :: ( b { 2 } ), Stuff :: ( c { 3 } ), Stuff :: ( d { 4 } )");
+
+        // However big they got, they're taken out completely when freed.
+        Interpret(interpreter, "Things <- nil, Stuff <- nil");
+        EXPECT_EQUAL(bytes, heap.LiveBytes());
+    }
+
+    void HeapTests::TestCountsCycles()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        heap.Collect();
+        size_t bytes = heap.LiveBytes();
+        int arrays = heap.LiveObjects(OBJECT_ARRAY);
+
+        Interpret(interpreter,
+                  "from: 1 to: 100 do: {|i| a <- #[], a add: a }");
+        EXPECT(heap.LiveObjects(OBJECT_ARRAY) >= arrays + 100);
+
+        heap.Collect();
+        EXPECT_EQUAL(arrays, heap.LiveObjects(OBJECT_ARRAY));
+        EXPECT_EQUAL(bytes, heap.LiveBytes());
+    }
+
+    void HeapTests::TestCollectsOwnHeap()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Interpreter other(host);
+        Heap & heap = interpreter.GetHeap();
+        Heap & otherHeap = other.GetHeap();
+
+        heap.Collect();
+        otherHeap.Collect();
+        int arrays = heap.LiveObjects(OBJECT_ARRAY);
+
+        Interpret(interpreter,
+                  "from: 1 to: 100 do: {|i| a <- #[], a add: a }");
+
+        // Collecting one interpreter leaves the other's garbage alone.
+        EXPECT_EQUAL(0, otherHeap.Collect());
+        EXPECT(heap.LiveObjects(OBJECT_ARRAY) >= arrays + 100);
+
+        EXPECT(heap.Collect() > 0);
+        EXPECT_EQUAL(arrays, heap.LiveObjects(OBJECT_ARRAY));
+    }
+
+    void HeapTests::TestCountsBlocks()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        EXPECT_EQUAL(0, heap.NumBlocks());
+        EXPECT_EQUAL(0u, heap.BlockBytes());
+
+        // The method body outlives the expression that defined it.
+        Interpret(interpreter, "Stuff <- [ go { 123 } ]");
+        EXPECT_EQUAL(1, heap.NumBlocks());
+        EXPECT(heap.BlockBytes() > 0);
+
+        Interpret(interpreter, "Stuff <- nil");
+        EXPECT_EQUAL(0, heap.NumBlocks());
+        EXPECT_EQUAL(0u, heap.BlockBytes());
+    }
+
+    void HeapTests::TestSoftLimit()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        heap.Collect();
+        size_t softLimit = heap.LiveBytes() + 20000;
+        heap.SetLimits(softLimit, 0);
+
+        // Garbage cycles are collected whenever the soft limit is passed,
+        // long before enough of them have piled up to run a collection
+        // otherwise.
+        Interpret(interpreter,
+                  "from: 1 to: 5000 do: {|i| a <- #[], a add: a }");
+        EXPECT(heap.LiveBytes() < softLimit + 1000);
+        EXPECT_EQUAL(0, host.Errors().Count());
+    }
+
+    void HeapTests::TestHardLimit()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        size_t hardLimit = heap.LiveBytes() + 100000;
+        heap.SetLimits(0, hardLimit);
+
+        Interpret(interpreter, "Things <- #[]");
+        Interpret(interpreter,
+                  "from: 1 to: 100000000 do: {|i| Things add: #[i] }");
+
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT_EQUAL(heap.LimitError(), host.Errors()[0]);
+
+        // The loop was stopped soon after going over.
+        int count = Global(interpreter, "Things").AsArray()->Elements().Count();
+        EXPECT(count > 100);
+        EXPECT(count < 10000);
+
+        // Once the memory is released, the interpreter can keep going.
+        Interpret(interpreter, "Things <- nil");
+        EXPECT(heap.LiveBytes() < hardLimit);
+
+        Interpret(interpreter, "Result <- 1 +number: 2");
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT_EQUAL(3, Global(interpreter, "Result").AsNumber());
+    }
+
+    void HeapTests::TestHardLimitOnLargeAllocation()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        Heap & heap = interpreter.GetHeap();
+
+        size_t hardLimit = heap.LiveBytes() + 100000;
+        heap.SetLimits(0, hardLimit);
+
+        // A number array that big is turned down before it's allocated.
+        Interpret(interpreter,
+                  "Numbers <- *primitive* number-array: 100000000");
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT(heap.LiveBytes() < hardLimit);
+
+        Interpret(interpreter, "Numbers <- *primitive* number-array: 100");
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT_EQUAL(OBJECT_NUMBER_ARRAY, Global(interpreter, "Numbers").Kind());
+    }
+
+    void HeapTests::TestStackOverflow()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+
+        Interpret(interpreter, "Recurse <- [ go { 1 + self go } ]");
+        Interpret(interpreter, "Recurse go");
+
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT_EQUAL(String("Stack overflow."), host.Errors()[0]);
+
+        Interpret(interpreter, "Result <- 1 +number: 2");
+        EXPECT_EQUAL(1, host.Errors().Count());
+        EXPECT_EQUAL(3, Global(interpreter, "Result").AsNumber());
+    }
+
+    void HeapTests::TestDumpObjects()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+
+        Interpret(interpreter, "Things <- #[\"some \\\"quoted\\\" text\"]");
+        Interpret(interpreter, "Stuff <- [ _a <- 1.5 ]");
+        std::string dump = DumpHeap(interpreter);
+
+        EXPECT(dump.find("{\"name\": \"Things\"") != std::string::npos);
+        EXPECT(dump.find("{\"name\": \"Stuff\"") != std::string::npos);
+        EXPECT(dump.find("\"kind\": \"array\"") != std::string::npos);
+        EXPECT(dump.find("\"value\": \"some \\\"quoted\\\" text\"") !=
+               std::string::npos);
+        EXPECT(dump.find("\"value\": 1.5") != std::string::npos);
+        EXPECT(dump.find("\"fields\": {\"_a\": ") != std::string::npos);
+        EXPECT(dump.find("\"name\": \"Object\"") != std::string::npos);
+
+        // Sites weren't being tracked.
+        EXPECT(dump.find("\"site\":") == std::string::npos);
+    }
+
+    void HeapTests::TestDumpRetainedSizes()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+
+        Interpret(interpreter, "Big <- #[], Small <- #[], Other <- #[]");
+        Interpret(interpreter,
+                  "from: 1 to: 1000 do: {|i| Big add: #[i] }");
+        Interpret(interpreter, "Shared <- #[], Small add: Shared");
+        Interpret(interpreter, "Other add: Shared");
+
+        std::string dump = DumpHeap(interpreter);
+
+        // Each global retains what only it refers to.
+        EXPECT(Retained(dump, "Big") > 1000 * sizeof(ArrayObject));
+        EXPECT(Retained(dump, "Small") < 1000);
+
+        // Once only one global refers to the shared array, it's retained by
+        // that one.
+        size_t small = Retained(dump, "Small");
+        Interpret(interpreter, "Other <- nil, Shared <- nil");
+        dump = DumpHeap(interpreter);
+        EXPECT(Retained(dump, "Small") > small);
+    }
+
+    void HeapTests::TestDumpSites()
+    {
+        HeapTestHost host;
+        Interpreter interpreter(host);
+        interpreter.GetHeap().TrackAllocationSites();
+
+        Interpret(interpreter, "Things <- #[]");
+        Interpret(interpreter,
+                  "from: 1 to: 10 do: {|i| Things add: (i +number: 0.5) }");
+        std::string dump = DumpHeap(interpreter);
+
+        EXPECT(dump.find("\"site\": {\"block\": ") != std::string::npos);
+        EXPECT(dump.find("\"message\": \"+number:\", \"objects\": 10") !=
+               std::string::npos);
+        EXPECT_EQUAL(0, host.Errors().Count());
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Test.h"
+
+namespace Finch
+{
+    class HeapTests : public Test
+    {
+    public:
+        static void Run();
+
+    private:
+        static void TestCountsObjects();
+        static void TestCountsGrowth();
+        static void TestCountsCycles();
+        static void TestCollectsOwnHeap();
+        static void TestCountsBlocks();
+        static void TestSoftLimit();
+        static void TestHardLimit();
+        static void TestHardLimitOnLargeAllocation();
+        static void TestStackOverflow();
+        static void TestDumpObjects();
+        static void TestDumpRetainedSizes();
+        static void TestDumpSites();
+    };
+}
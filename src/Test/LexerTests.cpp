@@ -1,35 +1,12 @@
 #include <stdarg.h>
 
+#include "FixedLineReader.h"
 #include "IErrorReporter.h"
-#include "ILineReader.h"
 #include "LexerTests.h"
 #include "Lexer.h"
 
 namespace Finch
 {
-    class FixedLineReader : public ILineReader
-    {
-    public:
-        FixedLineReader(const char * line)
-        : mLine(line)
-        {}
-        
-        virtual bool IsInfinite() const { return false; }
-        virtual bool EndOfLines() const { return mLine == NULL; }
-        
-        virtual String NextLine()
-        {
-            String line = mLine;
-            // only read the line once
-            mLine = NULL;
-            
-            return line;
-        }
-        
-    private:
-        const char * mLine;
-    };
-
     void LexerTests::Run()
     {
         // test the single character tokens
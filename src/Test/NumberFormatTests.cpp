@@ -0,0 +1,88 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#include "NumberFormatTests.h"
+#include "NumberFormat.h"
+
+namespace Finch
+{
+    void NumberFormatTests::Run()
+    {
+        TestIntegers();
+        TestDecimals();
+        TestExponents();
+        TestSpecialValues();
+        TestRoundTrip();
+    }
+    
+    void NumberFormatTests::TestIntegers()
+    {
+        EXPECT_EQUAL("0", NumberFormat::ToString(0));
+        EXPECT_EQUAL("1", NumberFormat::ToString(1));
+        EXPECT_EQUAL("999999", NumberFormat::ToString(999999));
+        EXPECT_EQUAL("-1234", NumberFormat::ToString(-1234));
+        EXPECT_EQUAL("1234567", NumberFormat::ToString(1234567));
+        EXPECT_EQUAL("9007199254740991", NumberFormat::ToString(9007199254740991.0));
+        EXPECT_EQUAL("9007199254740992", NumberFormat::ToString(9007199254740992.0));
+        EXPECT_EQUAL("100000000000000000000", NumberFormat::ToString(1e20));
+    }
+    
+    void NumberFormatTests::TestDecimals()
+    {
+        EXPECT_EQUAL("0.1", NumberFormat::ToString(0.1));
+        EXPECT_EQUAL("0.3", NumberFormat::ToString(0.3));
+        EXPECT_EQUAL("0.30000000000000004", NumberFormat::ToString(0.1 + 0.2));
+        EXPECT_EQUAL("-2.5", NumberFormat::ToString(-2.5));
+        EXPECT_EQUAL("3.14159", NumberFormat::ToString(3.14159));
+        EXPECT_EQUAL("0.3333333333333333", NumberFormat::ToString(1.0 / 3.0));
+        EXPECT_EQUAL("123.456", NumberFormat::ToString(123.456));
+        EXPECT_EQUAL("0.000001", NumberFormat::ToString(0.000001));
+    }
+    
+    void NumberFormatTests::TestExponents()
+    {
+        EXPECT_EQUAL("1e+21", NumberFormat::ToString(1e21));
+        EXPECT_EQUAL("1.5e+300", NumberFormat::ToString(1.5e300));
+        EXPECT_EQUAL("1e-7", NumberFormat::ToString(1e-7));
+        EXPECT_EQUAL("-1.25e-10", NumberFormat::ToString(-1.25e-10));
+        EXPECT_EQUAL("1.7976931348623157e+308", NumberFormat::ToString(1.7976931348623157e308));
+        EXPECT_EQUAL("5e-324", NumberFormat::ToString(5e-324));
+    }
+    
+    void NumberFormatTests::TestSpecialValues()
+    {
+        EXPECT_EQUAL("-0", NumberFormat::ToString(-0.0));
+        EXPECT_EQUAL("inf", NumberFormat::ToString(HUGE_VAL));
+        EXPECT_EQUAL("-inf", NumberFormat::ToString(-HUGE_VAL));
+        
+        double zero = 0;
+        EXPECT_EQUAL("nan", NumberFormat::ToString(zero / zero));
+    }
+    
+    void NumberFormatTests::TestRoundTrip()
+    {
+        // Random bit patterns cover every exponent, including denormals.
+        srand(5678);
+        for (int i = 0; i < 10000; i++)
+        {
+            uint64_t bits = 0;
+            for (int j = 0; j < 4; j++)
+            {
+                bits = (bits << 16) | (rand() & 0xffff);
+            }
+            
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            if ((value != value) || (value == HUGE_VAL) || (value == -HUGE_VAL)) continue;
+            
+            char buffer[NumberFormat::MaxLength];
+            int length = NumberFormat::Format(value, buffer);
+            
+            EXPECT(length < NumberFormat::MaxLength);
+            EXPECT(strtod(buffer, NULL) == value);
+        }
+    }
+}
+
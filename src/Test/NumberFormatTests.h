@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Test.h"
+
+namespace Finch
+{
+    class NumberFormatTests : public Test
+    {
+    public:
+        static void Run();
+        
+    private:
+        static void TestIntegers();
+        static void TestDecimals();
+        static void TestExponents();
+        static void TestSpecialValues();
+        static void TestRoundTrip();
+    };
+}
+
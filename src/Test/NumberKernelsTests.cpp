@@ -0,0 +1,158 @@
+#include <cmath>
+#include <limits>
+
+#include "NumberKernelsTests.h"
+#include "NumberKernels.h"
+
+namespace Finch
+{
+    void NumberKernelsTests::Run()
+    {
+        TestSum();
+        TestMinMax();
+        TestDot();
+        TestElementWise();
+        TestSort();
+    }
+    
+    void NumberKernelsTests::TestSum()
+    {
+        EXPECT_EQUAL(0.0, NumberKernels::Sum(NULL, 0));
+        
+        // Try every length around the vector sizes so that the leftovers get
+        // covered. Small integers add up exactly in any order.
+        double values[40];
+        for (int count = 0; count <= 40; count++)
+        {
+            double expected = 0;
+            for (int i = 0; i < count; i++)
+            {
+                values[i] = i * 3 - 20;
+                expected += values[i];
+            }
+            
+            EXPECT_EQUAL(expected, NumberKernels::Sum(values, count));
+        }
+        
+        // The partial sums are combined in a fixed order, so even inexact
+        // sums come out the same every time.
+        double fractions[1000];
+        for (int i = 0; i < 1000; i++) fractions[i] = 1.0 / (i + 1);
+        
+        double sum = NumberKernels::Sum(fractions, 1000);
+        EXPECT(std::fabs(sum - 7.485470860550345) < 1e-12);
+        EXPECT_EQUAL(sum, NumberKernels::Sum(fractions, 1000));
+    }
+    
+    void NumberKernelsTests::TestMinMax()
+    {
+        double values[40];
+        for (int count = 1; count <= 40; count++)
+        {
+            // Put the extremes in a different place each time.
+            for (int i = 0; i < count; i++) values[i] = (i * 7) % 13;
+            values[count * 5 / 7] = -100;
+            values[count - 1 - count / 3] = 100;
+            
+            double min = values[0];
+            double max = values[0];
+            for (int i = 1; i < count; i++)
+            {
+                if (values[i] < min) min = values[i];
+                if (values[i] > max) max = values[i];
+            }
+            
+            EXPECT_EQUAL(min, NumberKernels::Min(values, count));
+            EXPECT_EQUAL(max, NumberKernels::Max(values, count));
+        }
+        
+        // NaNs are skipped.
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        double withNaN[] = { nan, 3, nan, -2, 5, nan, nan, nan, nan, 1 };
+        EXPECT_EQUAL(-2.0, NumberKernels::Min(withNaN, 10));
+        EXPECT_EQUAL(5.0, NumberKernels::Max(withNaN, 10));
+        
+        double onlyNaN[] = { nan, nan, nan };
+        EXPECT(std::isnan(NumberKernels::Min(onlyNaN, 3)));
+        EXPECT(std::isnan(NumberKernels::Max(onlyNaN, 3)));
+        EXPECT(std::isnan(NumberKernels::Min(NULL, 0)));
+        
+        // A real infinity is still found.
+        double inf = std::numeric_limits<double>::infinity();
+        double infinite[] = { nan, inf, nan };
+        EXPECT_EQUAL(inf, NumberKernels::Min(infinite, 3));
+        EXPECT_EQUAL(inf, NumberKernels::Max(infinite, 3));
+    }
+    
+    void NumberKernelsTests::TestDot()
+    {
+        double left[40];
+        double right[40];
+        for (int count = 0; count <= 40; count++)
+        {
+            double expected = 0;
+            for (int i = 0; i < count; i++)
+            {
+                left[i] = i - 10;
+                right[i] = 2 * i + 1;
+                expected += left[i] * right[i];
+            }
+            
+            EXPECT_EQUAL(expected, NumberKernels::Dot(left, right, count));
+        }
+    }
+    
+    void NumberKernelsTests::TestElementWise()
+    {
+        double left[21];
+        double right[21];
+        double result[21];
+        for (int i = 0; i < 21; i++)
+        {
+            left[i] = i;
+            right[i] = 0.5 * i;
+        }
+        
+        NumberKernels::Add(left, right, result, 21);
+        for (int i = 0; i < 21; i++) EXPECT_EQUAL(1.5 * i, result[i]);
+        
+        NumberKernels::Add(left, 10, result, 21);
+        for (int i = 0; i < 21; i++) EXPECT_EQUAL(i + 10.0, result[i]);
+        
+        NumberKernels::Multiply(left, right, result, 21);
+        for (int i = 0; i < 21; i++) EXPECT_EQUAL(0.5 * i * i, result[i]);
+        
+        NumberKernels::Multiply(left, -2, result, 21);
+        for (int i = 0; i < 21; i++) EXPECT_EQUAL(-2.0 * i, result[i]);
+        
+        // The result can be one of the inputs.
+        NumberKernels::Multiply(left, 3, left, 21);
+        for (int i = 0; i < 21; i++) EXPECT_EQUAL(3.0 * i, left[i]);
+        
+        // Don't touch anything past the end.
+        result[5] = 99;
+        NumberKernels::Add(left, right, result, 5);
+        EXPECT_EQUAL(99.0, result[5]);
+    }
+    
+    void NumberKernelsTests::TestSort()
+    {
+        double values[] = { 5, -1, 3, 3, 0, 10, -7, 2 };
+        NumberKernels::Sort(values, 8);
+        
+        double sorted[] = { -7, -1, 0, 2, 3, 3, 5, 10 };
+        for (int i = 0; i < 8; i++) EXPECT_EQUAL(sorted[i], values[i]);
+        
+        // NaNs go at the end.
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        double withNaN[] = { nan, 2, nan, 1 };
+        NumberKernels::Sort(withNaN, 4);
+        EXPECT_EQUAL(1.0, withNaN[0]);
+        EXPECT_EQUAL(2.0, withNaN[1]);
+        EXPECT(std::isnan(withNaN[2]));
+        EXPECT(std::isnan(withNaN[3]));
+        
+        NumberKernels::Sort(NULL, 0);
+    }
+}
+
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Test.h"
+
+namespace Finch
+{
+    class NumberKernelsTests : public Test
+    {
+    public:
+        static void Run();
+        
+    private:
+        static void TestSum();
+        static void TestMinMax();
+        static void TestDot();
+        static void TestElementWise();
+        static void TestSort();
+    };
+}
+
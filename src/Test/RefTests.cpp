@@ -1,3 +1,5 @@
+#include <utility>
+
 #include "RefTests.h"
 #include "Ref.h"
 
@@ -82,6 +84,51 @@ namespace Finch
             
             b = Ref<int>();
         }
+        
+        // uniqueness
+        {
+            Ref<int> a;
+            EXPECT_EQUAL(false, a.IsUnique());
+            
+            a = Ref<int>(new int(123));
+            EXPECT_EQUAL(true, a.IsUnique());
+            
+            {
+                Ref<int> b = a;
+                EXPECT_EQUAL(false, a.IsUnique());
+                EXPECT_EQUAL(false, b.IsUnique());
+            }
+            
+            EXPECT_EQUAL(true, a.IsUnique());
+        }
+        
+        // moving
+        {
+            Ref<DestructorTester> a(new DestructorTester());
+            
+            {
+                Ref<DestructorTester> b = a;
+                Ref<DestructorTester> c = std::move(b);
+                
+                EXPECT_EQUAL(true, b.IsNull());
+                EXPECT_EQUAL(true, a == c);
+                EXPECT_EQUAL(false, c.IsUnique());
+                
+                // a is still linked to the moved reference.
+                a.Clear();
+                EXPECT_EQUAL(false, DestructorTester::Destructed());
+                EXPECT_EQUAL(true, c.IsUnique());
+                
+                a = std::move(c);
+                EXPECT_EQUAL(true, c.IsNull());
+                EXPECT_EQUAL(true, a.IsUnique());
+            }
+            
+            EXPECT_EQUAL(false, DestructorTester::Destructed());
+            
+            a = Ref<DestructorTester>();
+            EXPECT_EQUAL(true, DestructorTester::Destructed());
+        }
     }
 }
 
@@ -0,0 +1,83 @@
+#include "RegisterStackTests.h"
+#include "NumberObject.h"
+#include "RegisterStack.h"
+
+namespace Finch
+{
+    void RegisterStackTests::Run()
+    {
+        TestEnsure();
+        TestGrowKeepsValues();
+        TestOverflow();
+        TestFillAndClear();
+    }
+    
+    void RegisterStackTests::TestEnsure()
+    {
+        RegisterStack<Value> stack(4, 100);
+        
+        EXPECT_EQUAL(0, stack.Count());
+        
+        EXPECT(stack.Ensure(3));
+        EXPECT_EQUAL(3, stack.Count());
+        EXPECT(stack[0].IsNull());
+        EXPECT(stack[2].IsNull());
+        
+        // Asking for fewer doesn't shrink it.
+        EXPECT(stack.Ensure(1));
+        EXPECT_EQUAL(3, stack.Count());
+    }
+    
+    void RegisterStackTests::TestGrowKeepsValues()
+    {
+        RegisterStack<Value> stack(2, 1000);
+        
+        EXPECT(stack.Ensure(2));
+        stack[0] = Value(new NumberObject(Value(), 1));
+        stack[1] = Value(new NumberObject(Value(), 2));
+        
+        EXPECT(stack.Ensure(500));
+        EXPECT_EQUAL(500, stack.Count());
+        EXPECT_EQUAL(1, stack[0].AsNumber());
+        EXPECT_EQUAL(2, stack[1].AsNumber());
+        
+        // The new registers are null.
+        for (int i = 2; i < 500; i++)
+        {
+            EXPECT(stack[i].IsNull());
+        }
+    }
+    
+    void RegisterStackTests::TestOverflow()
+    {
+        RegisterStack<Value> stack(4, 10);
+        
+        EXPECT(stack.Ensure(10));
+        EXPECT(!stack.Ensure(11));
+        
+        // A failed Ensure() leaves the stack alone.
+        EXPECT_EQUAL(10, stack.Count());
+        EXPECT_EQUAL(10, stack.MaxSize());
+    }
+    
+    void RegisterStackTests::TestFillAndClear()
+    {
+        RegisterStack<Value> stack(8, 100);
+        Value number(new NumberObject(Value(), 3));
+        
+        EXPECT(stack.Ensure(6));
+        stack.Fill(1, 4, number);
+        
+        EXPECT(stack[0].IsNull());
+        EXPECT(stack[1] == number);
+        EXPECT(stack[4] == number);
+        EXPECT(stack[5].IsNull());
+        
+        stack.Clear(2, 6);
+        
+        EXPECT(stack[1] == number);
+        EXPECT(stack[2].IsNull());
+        EXPECT(stack[4].IsNull());
+    }
+}
+
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Test.h"
+
+namespace Finch
+{
+    class RegisterStackTests : public Test
+    {
+    public:
+        static void Run();
+        
+    private:
+        static void TestEnsure();
+        static void TestGrowKeepsValues();
+        static void TestOverflow();
+        static void TestFillAndClear();
+    };
+}
+
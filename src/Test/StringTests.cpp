@@ -1,4 +1,9 @@
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
 #include "StringTests.h"
+#include "Array.h"
 #include "FinchString.h"
 
 namespace Finch
@@ -11,10 +16,16 @@ namespace Finch
         TestSubscript();
         TestAddition();
         TestAssignment();
+        TestMove();
         TestCompoundAssignment();
         TestComparison();
         TestSubstring();
         TestReplace();
+        TestRope();
+        TestSlice();
+        TestInline();
+        TestIndexOf();
+        TestHashDistribution();
     }
     
     void StringTests::TestEmpty()
@@ -98,6 +109,32 @@ namespace Finch
         EXPECT_EQUAL("abc", b);
     }
     
+    void StringTests::TestMove()
+    {
+        // A long string hands over its heap data.
+        String a = "a string that is too long to be stored inline";
+        String b = std::move(a);
+        
+        EXPECT_EQUAL("a string that is too long to be stored inline", b);
+        EXPECT_EQUAL(0, a.Length());
+        
+        String c = "short";
+        c = std::move(b);
+        
+        EXPECT_EQUAL("a string that is too long to be stored inline", c);
+        EXPECT_EQUAL(0, b.Length());
+        
+        // Moving a string into itself leaves it alone.
+        String & d = c;
+        c = std::move(d);
+        EXPECT_EQUAL("a string that is too long to be stored inline", c);
+        
+        // An inline string is just copied.
+        String e = "short";
+        String f = std::move(e);
+        EXPECT_EQUAL("short", f);
+    }
+    
     void StringTests::TestCompoundAssignment()
     {
         String a = "abc";
@@ -125,6 +162,15 @@ namespace Finch
         EXPECT_EQUAL(false, a1 >= b);
         EXPECT_EQUAL(false, a1 == b);
         EXPECT_EQUAL(true, a1 != b);
+        
+        // comparing to C strings, which end at the first null character
+        String nulls = String("ab") + String('\0') + String("cd");
+        EXPECT_EQUAL(true,  a1 == "abc");
+        EXPECT_EQUAL(false, a1 == "ab");
+        EXPECT_EQUAL(false, a1 == "abcd");
+        EXPECT_EQUAL(false, nulls == "ab");
+        EXPECT_EQUAL(true,  nulls != "ab");
+        EXPECT_EQUAL(false, "ab" == nulls);
     }
     
     void StringTests::TestSubstring()
@@ -169,5 +215,228 @@ namespace Finch
 
         EXPECT_EQUAL("xbaybazba", String("xcyczc").Replace("c", "ba"));
     }
+    
+    void StringTests::TestRope()
+    {
+        // build a long string by appending, which creates a deep rope
+        String a;
+        for (int i = 0; i < 10000; i++)
+        {
+            a += String("0123456789");
+        }
+        
+        EXPECT_EQUAL(100000, a.Length());
+        EXPECT_EQUAL('0', a[0]);
+        EXPECT_EQUAL('9', a[99999]);
+        EXPECT_EQUAL("0123456789", a.Substring(50000, 10));
+        
+        // a rope must hash and compare the same as the flat string
+        String left = String("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        String right = String("ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+        String rope = left + right;
+        String flat = String(
+            "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+        
+        EXPECT_EQUAL(flat.HashCode(), rope.HashCode());
+        EXPECT_EQUAL(flat, rope);
+        
+        // shared sides are unaffected by flattening the rope
+        String both = rope + rope;
+        EXPECT_EQUAL(flat, both.Substring(104));
+        EXPECT_EQUAL(flat, rope);
+        
+        // concatenating with an empty string is a no-op
+        EXPECT_EQUAL(flat, rope + String());
+        EXPECT_EQUAL(flat, String() + rope);
+    }
+    
+    void StringTests::TestSlice()
+    {
+        String a = "0123456789";
+        String b = a.Substring(2, 5);
+        
+        EXPECT_EQUAL(5, b.Length());
+        EXPECT_EQUAL('2', b[0]);
+        EXPECT_EQUAL('\0', b[5]); // terminator
+        
+        // slices compare and hash the same as flat strings
+        EXPECT_EQUAL(String("23456"), b);
+        EXPECT_EQUAL(String("23456").HashCode(), b.HashCode());
+        EXPECT_EQUAL(0, b.CompareTo("23456"));
+        EXPECT(b < String("234567"));
+        EXPECT(b > String("2345"));
+        
+        // slice of a slice
+        String c = b.Substring(1, 3);
+        EXPECT_EQUAL("345", c);
+        
+        // slices of ropes
+        String rope = String("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz") +
+                      String("ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+        EXPECT_EQUAL("zA", rope.Substring(51, 2));
+        
+        // getting a terminated string from a slice doesn't affect the source
+        EXPECT_EQUAL(0, strcmp("23456", b.CString()));
+        EXPECT_EQUAL(0, strcmp("0123456789", a.CString()));
+        EXPECT_EQUAL("345", c);
+        
+        // a slice that runs to the end is already terminated
+        String d = a.Substring(7);
+        EXPECT_EQUAL(0, strcmp("789", d.CString()));
+        
+        // slices too long to copy inline share the source's buffer
+        String e = "the quick brown fox jumps over the lazy dog";
+        String f = e.Substring(4, 35);
+        EXPECT_EQUAL("quick brown fox jumps over the lazy", f);
+        EXPECT_EQUAL(String("quick brown fox jumps over the lazy").HashCode(),
+                     f.HashCode());
+        
+        String g = f.Substring(6, 25);
+        EXPECT_EQUAL("brown fox jumps over the ", g);
+        EXPECT_EQUAL(0, strcmp("brown fox jumps over the ", g.CString()));
+        EXPECT_EQUAL("quick brown fox jumps over the lazy", f);
+        
+        // characters read before getting a terminated string stay valid,
+        // even when the slice has the only reference to its source
+        String h = String("the quick brown fox jumps over the lazy dog").
+                   Substring(4, 30);
+        const char * chars = &h[0];
+        EXPECT_EQUAL(0, strcmp("quick brown fox jumps over the", h.CString()));
+        EXPECT_EQUAL(0, strncmp("quick brown fox jumps over the", chars, 30));
+        EXPECT_EQUAL(0, strcmp("quick brown fox jumps over the", h.CString()));
+    }
+    
+    void StringTests::TestInline()
+    {
+        // the inline characters, terminator and tag are all a string holds
+        EXPECT(sizeof(String) <= String::MaxInlineLength + 2);
+        
+        // strings right around the inline limit
+        String shortest = "0123456789012345678901";
+        String longest = "01234567890123456789012";
+        EXPECT_EQUAL(String::MaxInlineLength, shortest.Length());
+        EXPECT_EQUAL(String::MaxInlineLength + 1, longest.Length());
+        EXPECT_EQUAL(0, strcmp("0123456789012345678901", shortest.CString()));
+        EXPECT_EQUAL(0, strcmp("01234567890123456789012", longest.CString()));
+        EXPECT_EQUAL('\0', shortest[String::MaxInlineLength]);
+        EXPECT(shortest != longest);
+        EXPECT(shortest < longest);
+        EXPECT_EQUAL(shortest, longest.Substring(0, String::MaxInlineLength));
+        
+        // concatenating across the limit
+        EXPECT_EQUAL(shortest, String("01234567890") + String("12345678901"));
+        EXPECT_EQUAL(longest, shortest + '2');
+        
+        // copies and assignment between inline and heap strings
+        String a = shortest;
+        String b = longest;
+        a = b;
+        b = shortest;
+        EXPECT_EQUAL(longest, a);
+        EXPECT_EQUAL(shortest, b);
+        a = a;
+        EXPECT_EQUAL(longest, a);
+        
+        // rope nodes can have inline halves
+        String rope = longest + longest + "!";
+        EXPECT_EQUAL(47, rope.Length());
+        EXPECT_EQUAL('!', rope[46]);
+        EXPECT_EQUAL("12!", rope.Substring(-3));
+    }
+    
+    void StringTests::TestIndexOf()
+    {
+        String a = "0123401234";
+        EXPECT_EQUAL(0, a.IndexOf("0"));
+        EXPECT_EQUAL(5, a.IndexOf("0", 1));
+        EXPECT_EQUAL(2, a.IndexOf("234"));
+        EXPECT_EQUAL(7, a.IndexOf("234", 3));
+        EXPECT_EQUAL(-1, a.IndexOf("234", 8));
+        EXPECT_EQUAL(-1, a.IndexOf("4", 20));
+        EXPECT_EQUAL(0, a.IndexOf("01", -3));
+        EXPECT_EQUAL(-1, a.IndexOf("not found"));
+        EXPECT_EQUAL(-1, String().IndexOf("0"));
+        EXPECT_EQUAL(3, a.IndexOf("", 3));
+        
+        EXPECT_EQUAL(5, a.LastIndexOf("0"));
+        EXPECT_EQUAL(7, a.LastIndexOf("234"));
+        EXPECT_EQUAL(0, a.LastIndexOf(a));
+        EXPECT_EQUAL(-1, a.LastIndexOf("not found"));
+        EXPECT_EQUAL(10, a.LastIndexOf(""));
+        
+        // embedded null characters are searched like any other
+        String b = String("ab") + String('\0') + String("cd");
+        EXPECT_EQUAL(5, b.Length());
+        EXPECT_EQUAL(3, b.IndexOf("cd"));
+        EXPECT_EQUAL(1, b.IndexOf(String('b') + String('\0')));
+        EXPECT_EQUAL(2, b.LastIndexOf(String('\0')));
+        
+        // compare against a naive search for texts that end at every offset
+        // within and around the blocks the search looks at
+        const char * alphabet = "ab";
+        srand(1234);
+        for (int length = 0; length < 100; length++)
+        {
+            char text[100];
+            for (int i = 0; i < length; i++) text[i] = alphabet[rand() % 2];
+            text[length] = '\0';
+            
+            for (int needleLength = 1; needleLength <= 5; needleLength++)
+            {
+                char needle[6];
+                for (int i = 0; i < needleLength; i++)
+                {
+                    needle[i] = alphabet[rand() % 2];
+                }
+                needle[needleLength] = '\0';
+                
+                int first = -1;
+                int last = -1;
+                for (int i = 0; i + needleLength <= length; i++)
+                {
+                    if (strncmp(text + i, needle, needleLength) != 0) continue;
+                    if (first == -1) first = i;
+                    last = i;
+                }
+                
+                EXPECT_EQUAL(first, String(text).IndexOf(needle));
+                EXPECT_EQUAL(last, String(text).LastIndexOf(needle));
+            }
+        }
+    }
+    
+    void StringTests::TestHashDistribution()
+    {
+        // Hash a bunch of similar names into a power-of-two table the way
+        // Dictionary does, and make sure they spread out.
+        const int size = 4096;
+        Array<int> buckets(size, 0);
+        
+        for (int i = 0; i < size; i++)
+        {
+            String name = String::Format("name%d", i);
+            buckets[name.HashCode() % size]++;
+        }
+        
+        int used = 0;
+        int longest = 0;
+        for (int i = 0; i < size; i++)
+        {
+            if (buckets[i] > 0) used++;
+            if (buckets[i] > longest) longest = buckets[i];
+        }
+        
+        // A uniform hash fills about 63% of the buckets.
+        EXPECT(used > size / 2);
+        EXPECT(longest < 10);
+        
+        // Hashing is lazy, but the result must not depend on how the string
+        // was built.
+        String rope = String("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz") +
+                      String("ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+        String slice = rope.Substring(3, 17);
+        EXPECT_EQUAL(String("defghijklmnopqrst").HashCode(), slice.HashCode());
+        EXPECT_EQUAL(String::Hash("", 0), String().HashCode());
+    }
 }
-
@@ -16,10 +16,16 @@ namespace Finch
         static void TestSubscript();
         static void TestAddition();
         static void TestAssignment();
+        static void TestMove();
         static void TestCompoundAssignment();
         static void TestComparison();
         static void TestSubstring();
         static void TestReplace();
+        static void TestRope();
+        static void TestSlice();
+        static void TestInline();
+        static void TestIndexOf();
+        static void TestHashDistribution();
     };
 }
 
@@ -1,9 +1,14 @@
 #include <iostream>
 
 #include "ArrayTests.h"
+#include "DictionaryTests.h"
+#include "HeapTests.h"
 #include "LexerTests.h"
+#include "NumberFormatTests.h"
+#include "NumberKernelsTests.h"
 #include "QueueTests.h"
 #include "RefTests.h"
+#include "RegisterStackTests.h"
 #include "StackTests.h"
 #include "StringTests.h"
 #include "TokenTests.h"
@@ -14,9 +19,14 @@ int main (int argc, char * const argv[])
     using namespace Finch;
     
     ArrayTests::Run();
+    DictionaryTests::Run();
+    HeapTests::Run();
     LexerTests::Run();
+    NumberFormatTests::Run();
+    NumberKernelsTests::Run();
     QueueTests::Run();
     RefTests::Run();
+    RegisterStackTests::Run();
     StackTests::Run();
     StringTests::Run();
     TokenTests::Run();
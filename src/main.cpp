@@ -1,4 +1,5 @@
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <stdlib.h> // realpath
 #include <sys/param.h> // PATH_MAX
@@ -18,6 +19,7 @@ using std::endl;
 
 Ref<ILineReader> OpenFile(String filePath);
 bool InterpretFile(Interpreter & interpreter, String filePath);
+bool DumpHeap(Interpreter & interpreter, String filePath);
 PRIMITIVE(LoadFile);
 
 //### bob: should move this stuff into a "standalone" class
@@ -44,10 +46,24 @@ bool InterpretFile(Interpreter & interpreter, String filePath)
     return true;
 }
 
+bool DumpHeap(Interpreter & interpreter, String filePath)
+{
+    std::ofstream file(filePath.CString());
+    if (!file.is_open())
+    {
+        std::cout << "Couldn't write heap dump \"" << filePath << "\"" << std::endl;
+        return false;
+    }
+    
+    interpreter.DumpHeap(file);
+    return true;
+}
+
 PRIMITIVE(LoadFile)
 {
     String filePath = args[0].AsString();
     Ref<ILineReader> reader = OpenFile(filePath);
+    if (reader.IsNull()) return fiber.Nil();
     
     fiber.GetInterpreter().Interpret(*reader, false);
     return fiber.Nil();
@@ -61,6 +77,22 @@ int main (int argc, char * const argv[])
     // Set up the standalone-provided behavior.
     interpreter.BindMethod("Ether", "load:", LoadFile);
 
+    // "--heap-dump <path> <script>" runs the script and then dumps the heap
+    // to the given path. Objects are tagged with where they were created,
+    // so tracking has to start before anything is run.
+    const char * heapDumpPath = NULL;
+    if ((argc >= 2) && (strcmp(argv[1], "--heap-dump") == 0))
+    {
+        if (argc != 4)
+        {
+            cout << "Usage: finch --heap-dump <dump file> <script>" << endl;
+            return 1;
+        }
+        
+        heapDumpPath = argv[2];
+        interpreter.GetHeap().TrackAllocationSites();
+    }
+
     // Figure out the absolute path to the core library, relative to the
     // executable. Assumes a directory layout like:
     // finch
@@ -99,6 +131,13 @@ int main (int argc, char * const argv[])
         String fileName = argv[1];
         return InterpretFile(interpreter, fileName) ? 0 : 1;
     }
+    else if (heapDumpPath != NULL)
+    {
+        String fileName = argv[3];
+        if (!InterpretFile(interpreter, fileName)) return 1;
+        
+        return DumpHeap(interpreter, heapDumpPath) ? 0 : 1;
+    }
     
     return 0;
 }